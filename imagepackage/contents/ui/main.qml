@@ -70,6 +70,10 @@ QQC2.StackView {
         slideshowMode: wallpaper.configuration.SlideshowMode
         slideshowFoldersFirst: wallpaper.configuration.SlideshowFoldersFirst
         uncheckedSlides: wallpaper.configuration.UncheckedSlides
+        prerenderLeadTime: wallpaper.configuration.PrerenderLeadTime
+        fillMode: root.fillMode
+        // Don't wake up for slides that cannot be seen
+        outputVisible: root.Window.visibility !== Window.Hidden && root.Window.visibility !== Window.Minimized
 
         // Update wallpaper after resume from sleep
         onModelImageChanged: Qt.callLater(loadImage);
@@ -81,10 +85,21 @@ QQC2.StackView {
     onConfigColorChanged: Qt.callLater(loadImage);
     onBlurChanged: Qt.callLater(loadImage);
 
+    // Lets the image providers only decode the part of the image that is shown
+    function providerSource(url) {
+        var source = url.toString();
+
+        if (!source.startsWith("image://")) {
+            return url;
+        }
+
+        return source + (source.indexOf("?") === -1 ? "?" : "&") + "fillmode=" + root.fillMode;
+    }
+
     function loadImage() {
         var doesSkipAnimation = root.empty || imageWallpaper.isTransition;
         var pendingImage = baseImage.createObject(root, {
-                        "source": imageWallpaper.modelImage,
+                        "source": providerSource(imageWallpaper.modelImage),
                         "fillMode": root.fillMode,
                         "sourceSize": root.sourceSize,
                         "color": root.configColor,
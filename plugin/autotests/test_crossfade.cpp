@@ -0,0 +1,198 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include <algorithm>
+
+#include "provider/crossfade.h"
+#include "provider/crossfadekernels.h"
+
+class CrossFadeTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testCrossFade_data();
+    void testCrossFade();
+    void testCrossFadeKernels_data();
+    void testCrossFadeKernels();
+    void testCrossFadeFormats();
+    void testCrossFadeBenchmark();
+
+private:
+    QImage noise(const QSize &size, QImage::Format format, quint32 seed) const;
+    QImage paintedCrossFade(const QImage &from, const QImage &to, int step) const;
+    int maxDifference(const QImage &a, const QImage &b) const;
+};
+
+QImage CrossFadeTest::noise(const QSize &size, QImage::Format format, quint32 seed) const
+{
+    QImage image(size, QImage::Format_RGB32);
+    QRandomGenerator generator(seed);
+
+    for (int y = 0; y < image.height(); y++) {
+        auto line = reinterpret_cast<quint32 *>(image.scanLine(y));
+
+        for (int x = 0; x < image.width(); x++) {
+            line[x] = generator.generate() | 0xff000000;
+        }
+    }
+
+    return image.convertToFormat(format);
+}
+
+QImage CrossFadeTest::paintedCrossFade(const QImage &from, const QImage &to, int step) const
+{
+    QImage image = from.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    painter.setOpacity(step / 255.0);
+    painter.drawImage(0, 0, to);
+    painter.end();
+
+    return image.convertToFormat(QImage::Format_RGB32);
+}
+
+int CrossFadeTest::maxDifference(const QImage &a, const QImage &b) const
+{
+    int difference = 0;
+
+    for (int y = 0; y < a.height(); y++) {
+        const auto aLine = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+        const auto bLine = reinterpret_cast<const QRgb *>(b.constScanLine(y));
+
+        for (int x = 0; x < a.width(); x++) {
+            difference = std::max({difference,
+                                   std::abs(qRed(aLine[x]) - qRed(bLine[x])),
+                                   std::abs(qGreen(aLine[x]) - qGreen(bLine[x])),
+                                   std::abs(qBlue(aLine[x]) - qBlue(bLine[x]))});
+        }
+    }
+
+    return difference;
+}
+
+void CrossFadeTest::testCrossFade_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("step");
+
+    for (int step : {0, 1, 64, 128, 200, 254, 255}) {
+        // Not a multiple of the vector width, so the tail of every line is blended one by one
+        QTest::addRow("37x5 step %d", step) << QSize(37, 5) << step;
+    }
+
+    // Split over threads
+    QTest::addRow("2048x1100 step 100") << QSize(2048, 1100) << 100;
+}
+
+void CrossFadeTest::testCrossFade()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, step);
+
+    const QImage from = noise(size, QImage::Format_RGB32, 1);
+    const QImage to = noise(size, QImage::Format_RGB32, 2);
+
+    const QImage result = crossFade(from, to, step).convertToFormat(QImage::Format_RGB32);
+    const QImage expected = paintedCrossFade(from, to, step);
+    QCOMPARE(result.size(), expected.size());
+
+    // QPainter rounds the opacity differently
+    const int difference = maxDifference(result, expected);
+    QVERIFY2(difference <= 2, qPrintable(QString::number(difference)));
+
+    // The ends are the images themselves
+    if (step == 0) {
+        QCOMPARE(result, from);
+    } else if (step == 255) {
+        QCOMPARE(result, to);
+    }
+}
+
+void CrossFadeTest::testCrossFadeKernels_data()
+{
+    QTest::addColumn<int>("kernel");
+    QTest::addColumn<int>("step");
+
+    const std::vector<BlendLineKernel> kernels = blendLineKernels();
+
+    for (std::size_t i = 0; i < kernels.size(); i++) {
+        for (int step : {1, 64, 128, 200, 254}) {
+            QTest::addRow("%s step %d", kernels.at(i).name, step) << static_cast<int>(i) << step;
+        }
+    }
+}
+
+void CrossFadeTest::testCrossFadeKernels()
+{
+    QFETCH(int, kernel);
+    QFETCH(int, step);
+
+    const std::vector<BlendLineKernel> kernels = blendLineKernels();
+    const BlendLineFunction blendLine = kernels.at(kernel).function;
+    const BlendLineFunction blendLineScalar = kernels.front().function;
+    const int weight = (step * 256 + 127) / 255;
+
+    // Not a multiple of any vector width
+    const QSize size(37, 5);
+    const QImage from = noise(size, QImage::Format_RGB32, 1);
+    const QImage to = noise(size, QImage::Format_RGB32, 2);
+    QImage result(size, QImage::Format_RGB32);
+    QImage scalar(size, QImage::Format_RGB32);
+
+    for (int y = 0; y < size.height(); y++) {
+        const auto fromLine = reinterpret_cast<const quint32 *>(from.constScanLine(y));
+        const auto toLine = reinterpret_cast<const quint32 *>(to.constScanLine(y));
+
+        blendLine(reinterpret_cast<quint32 *>(result.scanLine(y)), fromLine, toLine, size.width(), weight);
+        blendLineScalar(reinterpret_cast<quint32 *>(scalar.scanLine(y)), fromLine, toLine, size.width(), weight);
+    }
+
+    // Every kernel rounds the same way
+    QCOMPARE(result, scalar);
+
+    const int difference = maxDifference(result, paintedCrossFade(from, to, step));
+    QVERIFY2(difference <= 2, qPrintable(QString::number(difference)));
+}
+
+void CrossFadeTest::testCrossFadeFormats()
+{
+    const QSize size(16, 16);
+
+    // The same formats are kept
+    QCOMPARE(crossFade(noise(size, QImage::Format_RGBX8888, 1), noise(size, QImage::Format_RGBX8888, 2), 128).format(), QImage::Format_RGBX8888);
+    QCOMPARE(crossFade(noise(size, QImage::Format_RGBX8888, 1), noise(size, QImage::Format_RGB32, 2), 128).format(), QImage::Format_RGB32);
+
+    // Translucent images go through QPainter
+    QImage translucent(size, QImage::Format_ARGB32);
+    translucent.fill(Qt::transparent);
+    const QImage from = noise(size, QImage::Format_RGB32, 1);
+    QCOMPARE(crossFade(from, translucent, 128).convertToFormat(QImage::Format_RGB32), from);
+
+    // Stretched to the first image
+    QCOMPARE(crossFade(from, noise(QSize(32, 8), QImage::Format_RGB32, 2), 128).size(), size);
+
+    QCOMPARE(crossFade(from, QImage(), 128), from);
+    QVERIFY(crossFade(QImage(), from, 128).isNull());
+}
+
+void CrossFadeTest::testCrossFadeBenchmark()
+{
+    const QSize size(3840, 2160);
+    const QImage from = noise(size, QImage::Format_RGB32, 1);
+    const QImage to = noise(size, QImage::Format_RGB32, 2);
+
+    QBENCHMARK {
+        crossFade(from, to, 128);
+    }
+}
+
+QTEST_MAIN(CrossFadeTest)
+
+#include "test_crossfade.moc"
@@ -0,0 +1,126 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QDir>
+#include <QStandardPaths>
+#include <QtTest>
+
+#include "finder/defaultwallpaperfinder.h"
+
+class DefaultWallpaperFinderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testDefaultWallpaperFinderPackage();
+    void testDefaultWallpaperFinderImage();
+    void testDefaultWallpaperFinderInvalid();
+    void testDefaultWallpaperFinderCache();
+    void testDefaultWallpaperFinderBroken();
+
+private:
+    QUrl findDefault(const QString &lookAndFeel, const QString &themeWallpaper, const QSize &targetSize) const;
+
+    QDir m_dataDir;
+    QDir m_alternateDir;
+    QSize m_targetSize;
+};
+
+void DefaultWallpaperFinderTest::initTestCase()
+{
+    // No Look and Feel package can be found in the test paths
+    QStandardPaths::setTestModeEnabled(true);
+
+    m_dataDir = QDir(QFINDTESTDATA("testdata/default"));
+    m_alternateDir = QDir(QFINDTESTDATA("testdata/alternate"));
+    QVERIFY(!m_dataDir.isEmpty());
+    QVERIFY(!m_alternateDir.isEmpty());
+
+    m_targetSize = QSize(1920, 1080);
+}
+
+QUrl DefaultWallpaperFinderTest::findDefault(const QString &lookAndFeel, const QString &themeWallpaper, const QSize &targetSize) const
+{
+    DefaultWallpaperFinder *finder = new DefaultWallpaperFinder(lookAndFeel, themeWallpaper, targetSize);
+    QSignalSpy spy(finder, &DefaultWallpaperFinder::defaultFound);
+
+    QThreadPool::globalInstance()->start(finder);
+
+    spy.wait(10 * 1000);
+
+    if (spy.count() != 1) {
+        return QUrl(QStringLiteral("invalid"));
+    }
+
+    return spy.takeFirst().at(0).toUrl();
+}
+
+void DefaultWallpaperFinderTest::testDefaultWallpaperFinderPackage()
+{
+    // A theme wallpaper inside a package resolves to the package
+    const QString packagePath = m_dataDir.absoluteFilePath(QStringLiteral("package"));
+    const QString themeWallpaper = packagePath + QStringLiteral("/contents/images/1920x1080.jpg");
+
+    QCOMPARE(findDefault(QStringLiteral("org.kde.test.package"), themeWallpaper, m_targetSize), QUrl::fromLocalFile(packagePath));
+}
+
+void DefaultWallpaperFinderTest::testDefaultWallpaperFinderImage()
+{
+    const QString themeWallpaper = m_dataDir.absoluteFilePath(QStringLiteral("wallpaper.jpg.jpg"));
+
+    QCOMPARE(findDefault(QStringLiteral("org.kde.test.image"), themeWallpaper, m_targetSize), QUrl::fromLocalFile(themeWallpaper));
+}
+
+void DefaultWallpaperFinderTest::testDefaultWallpaperFinderInvalid()
+{
+    QCOMPARE(findDefault(QStringLiteral("org.kde.test.invalid"), m_alternateDir.absoluteFilePath(QStringLiteral("thisisnotanimage.txt")), m_targetSize),
+             QUrl());
+    QCOMPARE(findDefault(QStringLiteral("org.kde.test.broken"), m_dataDir.absoluteFilePath(QStringLiteral("brokenpackage")), m_targetSize), QUrl());
+    QCOMPARE(findDefault(QStringLiteral("org.kde.test.empty"), QString(), m_targetSize), QUrl());
+
+    QVERIFY(!DefaultWallpaperFinder::isReadable(m_alternateDir.absoluteFilePath(QStringLiteral("thisisnotanimage.txt"))));
+    QVERIFY(DefaultWallpaperFinder::isReadable(m_dataDir.absoluteFilePath(QStringLiteral("wallpaper.jpg.jpg"))));
+}
+
+void DefaultWallpaperFinderTest::testDefaultWallpaperFinderCache()
+{
+    const QString lookAndFeel = QStringLiteral("org.kde.test.cache");
+    const QString themeWallpaper = m_dataDir.absoluteFilePath(QStringLiteral("wallpaper.jpg.jpg"));
+    QUrl url;
+
+    QVERIFY(!DefaultWallpaperFinder::cachedDefault(lookAndFeel, m_targetSize, url));
+
+    QCOMPARE(findDefault(lookAndFeel, themeWallpaper, m_targetSize), QUrl::fromLocalFile(themeWallpaper));
+
+    QVERIFY(DefaultWallpaperFinder::cachedDefault(lookAndFeel, m_targetSize, url));
+    QCOMPARE(url, QUrl::fromLocalFile(themeWallpaper));
+
+    // Each target size is resolved on its own
+    QVERIFY(!DefaultWallpaperFinder::cachedDefault(lookAndFeel, QSize(1024, 768), url));
+    QVERIFY(!DefaultWallpaperFinder::cachedDefault(QStringLiteral("org.kde.test.other"), m_targetSize, url));
+}
+
+void DefaultWallpaperFinderTest::testDefaultWallpaperFinderBroken()
+{
+    const QString lookAndFeel = QStringLiteral("org.kde.test.brokendefault");
+    const QString themeWallpaper = m_dataDir.absoluteFilePath(QStringLiteral("wallpaper.jpg.jpg"));
+    QUrl url;
+
+    QCOMPARE(findDefault(lookAndFeel, themeWallpaper, m_targetSize), QUrl::fromLocalFile(themeWallpaper));
+
+    // A default that failed to load is forgotten and not found again
+    DefaultWallpaperFinder::markBroken(QUrl::fromLocalFile(themeWallpaper));
+    QVERIFY(!DefaultWallpaperFinder::cachedDefault(lookAndFeel, m_targetSize, url));
+    QCOMPARE(findDefault(lookAndFeel, themeWallpaper, m_targetSize), QUrl());
+
+    QVERIFY(DefaultWallpaperFinder::cachedDefault(lookAndFeel, m_targetSize, url));
+    QVERIFY(url.isEmpty());
+}
+
+QTEST_MAIN(DefaultWallpaperFinderTest)
+
+#include "test_defaultwallpaperfinder.moc"
@@ -0,0 +1,324 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QDir>
+#include <QPainter>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <atomic>
+#include <thread>
+
+#include "provider/imagecache.h"
+#include "provider/xmlimageprovider.h"
+#include "slideshowtimeline.h"
+
+class ImageCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+    void testImageCacheDecode();
+    void testImageCacheKey();
+    void testImageCachePackage();
+    void testImageCacheBudget();
+    void testImageCacheCoalesce();
+    void testImageCachePrefetch();
+    void testImageCacheCrop();
+    void testImageCacheCancel();
+    void testXmlPrerender();
+
+private:
+    QDir m_dataDir;
+    QDir m_alternateDir;
+    QString m_wallpaperPath;
+    QString m_packagePath;
+};
+
+void ImageCacheTest::initTestCase()
+{
+    m_dataDir = QDir(QFINDTESTDATA("testdata/default"));
+    m_alternateDir = QDir(QFINDTESTDATA("testdata/alternate"));
+    QVERIFY(!m_dataDir.isEmpty());
+    QVERIFY(!m_alternateDir.isEmpty());
+
+    m_wallpaperPath = m_dataDir.absoluteFilePath(QStringLiteral("wallpaper.jpg.jpg"));
+    m_packagePath = m_dataDir.absoluteFilePath(QStringLiteral("package")) + QDir::separator();
+}
+
+void ImageCacheTest::cleanup()
+{
+    ImageCache::self()->clear();
+    ImageCache::self()->setBudget(128 * 1024 * 1024);
+}
+
+void ImageCacheTest::testImageCacheDecode()
+{
+    // The preferred image of a package
+    QCOMPARE(ImageCache::decodeSlide(m_packagePath, QSize(1920, 1080)).size(), QSize(1920, 1080));
+
+    // Scaled down to cover the requested size
+    const QImage scaled = ImageCache::decodeSlide(m_packagePath, QSize(960, 540));
+    QVERIFY(scaled.width() >= 960 && scaled.height() >= 540);
+    QVERIFY(scaled.width() == 960 || scaled.height() == 540);
+
+    // Never scaled up
+    QCOMPARE(ImageCache::readImage(m_wallpaperPath, QSize(1920, 1080)).size(), QSize(15, 16));
+
+    // A large JPEG is scaled while it is decoded
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString largePath = dir.filePath(QStringLiteral("large.jpg"));
+    QImage large(8000, 2000, QImage::Format_RGB32);
+    large.fill(Qt::darkBlue);
+    QVERIFY(large.save(largePath));
+    QCOMPARE(ImageCache::readImage(largePath, QSize(1920, 1080)).size(), QSize(4320, 1080));
+
+    QVERIFY(ImageCache::decodeSlide(m_alternateDir.absoluteFilePath(QStringLiteral("thisisnotanimage.txt")), QSize(1920, 1080)).isNull());
+    QVERIFY(ImageCache::decodeSlide(m_dataDir.absoluteFilePath(QStringLiteral("brokenpackage")), QSize(1920, 1080)).isNull());
+    QVERIFY(ImageCache::decodeSlide(QString(), QSize(1920, 1080)).isNull());
+}
+
+void ImageCacheTest::testImageCacheKey()
+{
+    const QSize size(1920, 1080);
+
+    // A package is keyed by its preferred image
+    QCOMPARE(ImageCache::slideKey(m_packagePath, size),
+             ImageCache::cacheKey(m_dataDir.absoluteFilePath(QStringLiteral("package/contents/images/1920x1080.jpg")), size));
+    QVERIFY(ImageCache::slideKey(m_dataDir.absoluteFilePath(QStringLiteral("brokenpackage")), size).isEmpty());
+
+    QVERIFY(ImageCache::cacheKey(m_wallpaperPath, size) != ImageCache::cacheKey(m_wallpaperPath, QSize(1024, 768)));
+    QVERIFY(ImageCache::cacheKey(m_wallpaperPath, size) != ImageCache::cacheKey(m_wallpaperPath, size, QStringLiteral("1")));
+
+    // A changed file is decoded again
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("wallpaper.jpg"));
+    QVERIFY(QFile::copy(m_wallpaperPath, path));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    const QString oldKey = ImageCache::cacheKey(path, size);
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(-3600), QFileDevice::FileModificationTime));
+    QVERIFY(ImageCache::cacheKey(path, size) != oldKey);
+}
+
+void ImageCacheTest::testImageCachePackage()
+{
+    const QSize size(1280, 1024);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkpath(QStringLiteral("contents/images")));
+    QVERIFY(QFile::copy(m_dataDir.absoluteFilePath(QStringLiteral("package/metadata.desktop")), dir.filePath(QStringLiteral("metadata.desktop"))));
+    QVERIFY(QFile::copy(m_wallpaperPath, dir.filePath(QStringLiteral("contents/images/1920x1080.jpg"))));
+
+    QCOMPARE(ImageCache::slideKey(dir.path(), size), ImageCache::cacheKey(dir.filePath(QStringLiteral("contents/images/1920x1080.jpg")), size));
+
+    // The preferred image is resolved again when the images change
+    QTest::qWait(50);
+    QVERIFY(QFile::copy(m_wallpaperPath, dir.filePath(QStringLiteral("contents/images/1280x1024.jpg"))));
+    QCOMPARE(ImageCache::slideKey(dir.path(), size), ImageCache::cacheKey(dir.filePath(QStringLiteral("contents/images/1280x1024.jpg")), size));
+}
+
+void ImageCacheTest::testImageCacheBudget()
+{
+    ImageCache *cache = ImageCache::self();
+
+    QImage image(512, 512, QImage::Format_ARGB32);
+    image.fill(Qt::black);
+
+    // Room for two images of 1 MiB
+    cache->setBudget(2 * 1024 * 1024);
+    QCOMPARE(cache->budget(), 2 * 1024 * 1024);
+
+    cache->insert(QStringLiteral("a"), image);
+    cache->insert(QStringLiteral("b"), image);
+    QVERIFY(cache->contains(QStringLiteral("a")));
+    QVERIFY(cache->contains(QStringLiteral("b")));
+
+    // Implicitly shared, not copied
+    QCOMPARE(cache->find(QStringLiteral("a")).constBits(), image.constBits());
+
+    // The least recently used image is dropped
+    QVERIFY(!cache->find(QStringLiteral("a")).isNull());
+    cache->insert(QStringLiteral("c"), image);
+    QVERIFY(cache->contains(QStringLiteral("a")));
+    QVERIFY(!cache->contains(QStringLiteral("b")));
+    QVERIFY(cache->contains(QStringLiteral("c")));
+
+    // An image larger than the budget is not kept
+    cache->insert(QStringLiteral("d"), QImage(1024, 1024, QImage::Format_ARGB32));
+    QVERIFY(!cache->contains(QStringLiteral("d")));
+}
+
+void ImageCacheTest::testImageCacheCoalesce()
+{
+    ImageCache *cache = ImageCache::self();
+    std::atomic<int> decodeCount = 0;
+
+    const auto decoder = [&decodeCount] {
+        decodeCount++;
+        QThread::msleep(200);
+
+        QImage image(16, 16, QImage::Format_ARGB32);
+        image.fill(Qt::white);
+        return image;
+    };
+
+    // Every screen asks for the same image at the same time
+    std::vector<QImage> images(4);
+    std::vector<std::thread> threads;
+
+    for (QImage &image : images) {
+        threads.emplace_back([cache, &decoder, &image] {
+            image = cache->decode(QStringLiteral("coalesce"), decoder);
+        });
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (const QImage &image : images) {
+        QCOMPARE(image.size(), QSize(16, 16));
+    }
+
+    QCOMPARE(decodeCount.load(), 1);
+
+    // Cached afterwards
+    QCOMPARE(cache->decode(QStringLiteral("coalesce"), decoder).size(), QSize(16, 16));
+    QCOMPARE(decodeCount.load(), 1);
+
+    // A failed decode is not cached
+    QVERIFY(cache->decode(QStringLiteral("null"), [] {
+                     return QImage();
+                 }).isNull());
+    QVERIFY(!cache->contains(QStringLiteral("null")));
+}
+
+void ImageCacheTest::testImageCachePrefetch()
+{
+    ImageCache *cache = ImageCache::self();
+    const QSize size(1920, 1080);
+
+    cache->prefetch({m_wallpaperPath, m_packagePath, m_alternateDir.absoluteFilePath(QStringLiteral("thisisnotanimage.txt"))}, size);
+    cache->waitForPrefetch();
+
+    QCOMPARE(cache->find(ImageCache::slideKey(m_wallpaperPath, size)).size(), QSize(15, 16));
+    QCOMPARE(cache->find(ImageCache::slideKey(m_packagePath, size)).size(), size);
+    // Trailing separators do not matter
+    QVERIFY(cache->contains(ImageCache::slideKey(m_dataDir.absoluteFilePath(QStringLiteral("package")), size)));
+    QVERIFY(!cache->contains(ImageCache::slideKey(m_alternateDir.absoluteFilePath(QStringLiteral("thisisnotanimage.txt")), size)));
+}
+
+void ImageCacheTest::testImageCacheCrop()
+{
+    const QSize size(1920, 1080);
+
+    // A panorama with the part that is shown in blue
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("panorama.jpg"));
+    QImage panorama(8000, 2000, QImage::Format_RGB32);
+    panorama.fill(Qt::red);
+    QPainter painter(&panorama);
+    painter.fillRect(2200, 0, 3600, 2000, Qt::blue);
+    painter.end();
+    QVERIFY(panorama.save(path));
+
+    QVERIFY(ImageCache::slideKey(path, size, true) != ImageCache::slideKey(path, size));
+    QVERIFY(ImageCache::isCropFillMode(2));
+    QVERIFY(!ImageCache::isCropFillMode(1));
+
+    // Only the centered part with the aspect ratio of the screen is decoded
+    const QImage image = ImageCache::decodeSlide(path, size, true);
+    QCOMPARE(image.size(), size);
+
+    for (const QPoint &point : {QPoint(5, 540), QPoint(960, 5), QPoint(1914, 1074)}) {
+        const QRgb pixel = image.pixel(point);
+        QVERIFY2(qBlue(pixel) > 200 && qRed(pixel) < 60, qPrintable(QString::number(pixel, 16)));
+    }
+
+    // The whole image covers the screen without cropping
+    QCOMPARE(ImageCache::decodeSlide(path, size).size(), QSize(4320, 1080));
+}
+
+void ImageCacheTest::testImageCacheCancel()
+{
+    ImageCache *cache = ImageCache::self();
+    const QSize size(1920, 1080);
+    const std::atomic_bool canceled(true);
+
+    QVERIFY(ImageCache::readImage(m_wallpaperPath, size, false, &canceled).isNull());
+
+    // A canceled decode is not cached
+    QVERIFY(ImageCache::decodeSlide(m_packagePath, size, false, &canceled).isNull());
+    QVERIFY(!cache->contains(ImageCache::slideKey(m_packagePath, size)));
+    QCOMPARE(ImageCache::decodeSlide(m_packagePath, size).size(), size);
+
+    const QString path = m_dataDir.absoluteFilePath(QStringLiteral("xml/timeofday.xml"));
+    const auto timeline = SlideshowTimeline::load(path, size);
+    QVERIFY(timeline);
+    const QDateTime transition = timeline->startTime(QDateTime::currentDateTime()).addDays(30).addSecs(11 * 3600);
+
+    QVERIFY(XmlImageProvider::renderFrame(path, size, transition, false, &canceled).isNull());
+    QVERIFY(!XmlImageProvider::renderFrame(path, size, transition).isNull());
+
+    // A cached frame costs nothing, so it is still returned
+    QVERIFY(!XmlImageProvider::renderFrame(path, size, transition, false, &canceled).isNull());
+}
+
+void ImageCacheTest::testXmlPrerender()
+{
+    ImageCache *cache = ImageCache::self();
+    const QSize size(1920, 1080);
+    const QDir xmlDir(m_dataDir.absoluteFilePath(QStringLiteral("xml")));
+    const QString path = xmlDir.absoluteFilePath(QStringLiteral("timeofday.xml"));
+    const QString light = xmlDir.absoluteFilePath(QStringLiteral(".light.png"));
+    const QString dark = xmlDir.absoluteFilePath(QStringLiteral(".dark.png"));
+
+    const auto timeline = SlideshowTimeline::load(path, size);
+    QVERIFY(timeline);
+    const QDateTime day = timeline->startTime(QDateTime::currentDateTime()).addDays(30);
+
+    // Day at 12 PM
+    XmlImageProvider::prerender(path, size, day.addSecs(4 * 3600));
+    cache->waitForPrefetch();
+    QVERIFY(cache->contains(ImageCache::cacheKey(light, size)));
+
+    // Halfway from day to night at 7 PM
+    const QString stepKey = ImageCache::cacheKey(light, size, ImageCache::fileKey(dark) + QStringLiteral("/128"));
+    QVERIFY(XmlImageProvider::findStep(stepKey).isNull());
+    XmlImageProvider::prerender(path, size, day.addSecs(11 * 3600));
+    cache->waitForPrefetch();
+    QCOMPARE(XmlImageProvider::findStep(stepKey).size(), QSize(415, 282));
+
+    // A step is only shown once, so it does not take the budget of the slides
+    QVERIFY(!cache->contains(stepKey));
+
+    // Both ends are pinned for the next steps, even when the budget is used up
+    cache->setBudget(0);
+    QVERIFY(cache->contains(ImageCache::cacheKey(dark, size)));
+    QVERIFY(cache->contains(ImageCache::cacheKey(light, size)));
+
+    // The request when the frame is due gets the prerendered image
+    QCOMPARE(XmlImageProvider::renderFrame(path, size, day.addSecs(11 * 3600)).constBits(), XmlImageProvider::findStep(stepKey).constBits());
+
+    // Once the transition is over, the ends go back to the budget and the steps are dropped
+    cache->setBudget(128 * 1024 * 1024);
+    QVERIFY(!XmlImageProvider::renderFrame(path, size, day.addSecs(16 * 3600)).isNull());
+    QVERIFY(XmlImageProvider::findStep(stepKey).isNull());
+    cache->setBudget(0);
+    QVERIFY(!cache->contains(ImageCache::cacheKey(light, size)));
+}
+
+QTEST_MAIN(ImageCacheTest)
+
+#include "test_imagecache.moc"
@@ -23,6 +23,7 @@ private Q_SLOTS:
     void testImageListModelData();
     void testImageListModelIndexOf();
     void testImageListModelLoad();
+    void testImageListModelReload();
     void testImageListModelAddBackground();
     void testImageListModelRemoveBackground();
     void testImageListModelRemoveLocalBackground();
@@ -130,6 +131,34 @@ void ImageListModelTest::testImageListModelLoad()
     QCOMPARE(m_model->index(0, 0).data(Qt::DisplayRole), QStringLiteral("dummy"));
 }
 
+void ImageListModelTest::testImageListModelReload()
+{
+    QPersistentModelIndex idx = m_model->index(0, 0);
+    QCOMPARE(idx.data(ImageRoles::ResolutionRole).toString(), QString());
+    QVERIFY(m_dataSpy->wait());
+    m_dataSpy->clear();
+    QCOMPARE(idx.data(ImageRoles::ResolutionRole).toString(), QStringLiteral("15x16"));
+
+    QSignalSpy loadedSpy(m_model, &ImageListModel::loaded);
+    QSignalSpy removedSpy(m_model, &ImageListModel::rowsRemoved);
+
+    // Changing the target size does not scan the folder again
+    m_model->slotTargetSizeChanged(QSize(1280, 1024));
+    QCOMPARE(loadedSpy.size(), 0);
+    QCOMPARE(m_countSpy->size(), 0);
+    QCOMPARE(m_dataSpy->size(), 0);
+
+    m_model->reload();
+    QVERIFY(loadedSpy.wait(10 * 1000));
+
+    // The image is unchanged, so the row and its cache should be kept.
+    QCOMPARE(m_countSpy->size(), 0);
+    QCOMPARE(removedSpy.size(), 0);
+    QCOMPARE(m_dataSpy->size(), 0);
+    QVERIFY(idx.isValid());
+    QVERIFY(m_model->m_imageSizeCache.contains(m_wallpaperPath));
+}
+
 void ImageListModelTest::testImageListModelAddBackground()
 {
     // Case 1: add a valid image
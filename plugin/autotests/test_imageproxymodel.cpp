@@ -10,9 +10,11 @@
 #include <KIO/CopyJob>
 
 #include "../finder/xmlfinder.h"
+#include "../model/directorywatcher.h"
 #include "../model/imagelistmodel.h"
 #include "../model/imageproxymodel.h"
 #include "../model/packagelistmodel.h"
+#include "../model/wallpapercatalog.h"
 #include "../model/xmlimagelistmodel.h"
 
 class ImageProxyModelTest : public QObject
@@ -25,16 +27,19 @@ private Q_SLOTS:
     void cleanup();
     void cleanupTestCase();
 
+    void testImageProxyModelProgressiveLoading();
     void testImageProxyModelIndexOf();
     void testImageProxyModelReload();
     void testImageProxyModelAddBackground();
     void testImageProxyModelRemoveBackground();
     void testImageProxyModelDirWatch();
+    void testImageProxyModelWatchCount();
 
 private:
     QPointer<ImageProxyModel> m_model = nullptr;
     QPointer<QSignalSpy> m_countSpy = nullptr;
     QPointer<QSignalSpy> m_dataSpy = nullptr;
+    DirectoryWatcher *m_dirWatch = nullptr;
 
     QDir m_dataDir;
     QDir m_alternateDir;
@@ -69,6 +74,9 @@ void ImageProxyModelTest::initTestCase()
     m_modelNum = 3;
     m_targetSize = QSize(1920, 1080);
 
+    // Shared by all models
+    m_dirWatch = WallpaperCatalog::self()->directoryWatcher();
+
     QStandardPaths::setTestModeEnabled(true);
 }
 
@@ -107,6 +115,11 @@ void ImageProxyModelTest::cleanup()
     m_model->deleteLater();
     m_countSpy->deleteLater();
     m_dataSpy->deleteLater();
+
+    // The models are deleted first, then the shared folders they released,
+    // so the next test starts from scratch
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
 }
 
 void ImageProxyModelTest::cleanupTestCase()
@@ -116,6 +129,35 @@ void ImageProxyModelTest::cleanupTestCase()
     QDir(standardPath).removeRecursively();
 }
 
+void ImageProxyModelTest::testImageProxyModelProgressiveLoading()
+{
+    auto model = new ImageProxyModel({m_dataDir.absolutePath()}, m_targetSize, this);
+    QSignalSpy loadingSpy(model, &ImageProxyModel::loadingChanged);
+
+    // All source models are attached before any of them is loaded
+    QCOMPARE(model->sourceModels().size(), m_modelNum);
+    QCOMPARE(model->rowCount(), 0);
+    QVERIFY(model->loading());
+    QCOMPARE(model->loadingProgress(), 0.0);
+
+    // Each source model reports its own progress
+    while (model->loading()) {
+        const int rowCount = model->rowCount();
+        QVERIFY(loadingSpy.wait(5 * 1000));
+        QVERIFY(model->rowCount() >= rowCount);
+    }
+
+    QCOMPARE(loadingSpy.size(), m_modelNum);
+    QCOMPARE(model->loadingProgress(), 1.0);
+    QCOMPARE(model->rowCount(), 4);
+
+    // Sources keep a stable order: images, packages, then xml wallpapers
+    QCOMPARE(model->index(0, 0).data(ImageRoles::PackageNameRole).toString(), m_wallpaperPath);
+    QCOMPARE(model->index(1, 0).data(ImageRoles::PackageNameRole).toString(), m_packagePath + QDir::separator());
+
+    model->deleteLater();
+}
+
 void ImageProxyModelTest::testImageProxyModelIndexOf()
 {
     QVERIFY(m_model->indexOf(m_wallpaperPath) >= 0);
@@ -127,13 +169,20 @@ void ImageProxyModelTest::testImageProxyModelIndexOf()
 
 void ImageProxyModelTest::testImageProxyModelReload()
 {
+    QSignalSpy imageLoadedSpy(m_model->m_imageModel, &AbstractImageListModel::loaded);
+    QSignalSpy packageLoadedSpy(m_model->m_packageModel, &AbstractImageListModel::loaded);
+    QSignalSpy xmlLoadedSpy(m_model->m_xmlModel, &AbstractImageListModel::loaded);
+    QSignalSpy removedSpy(m_model, &ImageProxyModel::rowsRemoved);
+
     m_model->reload();
 
-    for (int i = 0; i < m_modelNum; i++) {
-        m_countSpy->wait(5 * 1000);
+    for (QSignalSpy *spy : {&imageLoadedSpy, &packageLoadedSpy, &xmlLoadedSpy}) {
+        QVERIFY(spy->size() == 1 || spy->wait(5 * 1000));
     }
-    QCOMPARE(m_countSpy->size(), m_modelNum);
-    m_countSpy->clear();
+
+    // Nothing has changed, so no row should be touched
+    QCOMPARE(m_countSpy->size(), 0);
+    QCOMPARE(removedSpy.size(), 0);
 
     QCOMPARE(m_model->rowCount(), 4);
     QCOMPARE(m_model->m_imageModel->rowCount(), 1);
@@ -185,11 +234,13 @@ void ImageProxyModelTest::testImageProxyModelAddBackground()
     QCOMPARE(m_model->m_xmlModel->count(), 3);
 
     // Test KDirWatch
-    QVERIFY(m_model->m_dirWatch.contains(m_dummyWallpaperPath));
-    QVERIFY(m_model->m_dirWatch.contains(m_dummyPackagePath));
-    QVERIFY(m_model->m_dirWatch.contains(m_dummyXmlPath));
-    QVERIFY(m_model->m_dirWatch.contains(m_alternateDir.absoluteFilePath(QStringLiteral("xml/.dummy.png"))));
-    QVERIFY(!m_model->m_dirWatch.contains(m_alternateDir.absoluteFilePath(QStringLiteral("xml/invalid.xml"))));
+    QVERIFY(m_dirWatch->contains(m_dummyWallpaperPath));
+    QVERIFY(m_dirWatch->contains(m_dummyPackagePath));
+    QVERIFY(m_dirWatch->contains(m_dummyXmlPath));
+    QVERIFY(m_dirWatch->contains(m_alternateDir.absoluteFilePath(QStringLiteral("xml/.dummy.png"))));
+    QVERIFY(!m_dirWatch->contains(m_alternateDir.absoluteFilePath(QStringLiteral("xml/invalid.xml"))));
+    // The root folder, the folder of the image, the package and the folder of the xml file
+    QCOMPARE(m_dirWatch->watchCount(), 4);
 
     QCOMPARE(m_model->m_pendingAddition.size(), 3);
 }
@@ -217,7 +268,7 @@ void ImageProxyModelTest::testImageProxyModelRemoveBackground()
     QCOMPARE(m_model->m_packageModel->count(), 2);
     QCOMPARE(m_model->m_xmlModel->count(), 3);
     QCOMPARE(m_model->count(), --count);
-    QVERIFY(!m_model->m_dirWatch.contains(m_dummyWallpaperPath));
+    QVERIFY(!m_dirWatch->contains(m_dummyWallpaperPath));
 
     m_model->removeBackground(m_dummyPackagePath);
     QCOMPARE(m_countSpy->size(), 1);
@@ -226,7 +277,7 @@ void ImageProxyModelTest::testImageProxyModelRemoveBackground()
     QCOMPARE(m_model->m_packageModel->count(), 1);
     QCOMPARE(m_model->m_xmlModel->count(), 3);
     QCOMPARE(m_model->count(), --count);
-    QVERIFY(!m_model->m_dirWatch.contains(m_dummyPackagePath));
+    QVERIFY(!m_dirWatch->contains(m_dummyPackagePath));
 
     m_model->removeBackground(m_dummyXmlPath);
     QCOMPARE(m_countSpy->size(), 1);
@@ -235,10 +286,11 @@ void ImageProxyModelTest::testImageProxyModelRemoveBackground()
     QCOMPARE(m_model->m_packageModel->count(), 1);
     QCOMPARE(m_model->m_xmlModel->count(), 2);
     QCOMPARE(m_model->count(), --count);
-    QVERIFY(!m_model->m_dirWatch.contains(m_dummyXmlPath));
-    QVERIFY(!m_model->m_dirWatch.contains(m_alternateDir.absoluteFilePath(QStringLiteral("xml/.dummy.png"))));
+    QVERIFY(!m_dirWatch->contains(m_dummyXmlPath));
+    QVERIFY(!m_dirWatch->contains(m_alternateDir.absoluteFilePath(QStringLiteral("xml/.dummy.png"))));
 
     QCOMPARE(m_model->m_pendingAddition.size(), 0);
+    QCOMPARE(m_dirWatch->watchCount(), 1);
 
     // Case 2: remove an unexisting wallpaper
     m_model->removeBackground(m_dummyWallpaperPath);
@@ -248,11 +300,13 @@ void ImageProxyModelTest::testImageProxyModelRemoveBackground()
 
 void ImageProxyModelTest::testImageProxyModelDirWatch()
 {
-    QVERIFY(m_model->m_dirWatch.contains(m_dataDir.absolutePath()));
-    QVERIFY(m_model->m_dirWatch.contains(m_wallpaperPath));
-    QVERIFY(m_model->m_dirWatch.contains(m_packagePath));
-    QVERIFY(m_model->m_dirWatch.contains(m_xmlPath));
-    QVERIFY(m_model->m_dirWatch.contains(m_dataDir.absoluteFilePath(QStringLiteral("xml/.light.png"))));
+    QVERIFY(m_dirWatch->contains(m_dataDir.absolutePath()));
+    QVERIFY(m_dirWatch->contains(m_wallpaperPath));
+    QVERIFY(m_dirWatch->contains(m_packagePath));
+    QVERIFY(m_dirWatch->contains(m_xmlPath));
+    QVERIFY(m_dirWatch->contains(m_dataDir.absoluteFilePath(QStringLiteral("xml/.light.png"))));
+    // Everything is inside the root folder
+    QCOMPARE(m_dirWatch->watchCount(), 1);
 
     m_model->deleteLater();
     m_countSpy->deleteLater();
@@ -270,7 +324,7 @@ void ImageProxyModelTest::testImageProxyModelDirWatch()
     QCOMPARE(m_countSpy->size(), 0);
     QCOMPARE(m_model->sourceModels().size(), m_modelNum);
     QCOMPARE(m_model->rowCount(), 0);
-    QVERIFY(m_model->m_dirWatch.contains(standardPath));
+    QVERIFY(m_dirWatch->contains(standardPath));
 
     // Copy an image to the folder
     QFile imageFile(m_wallpaperPath);
@@ -283,7 +337,7 @@ void ImageProxyModelTest::testImageProxyModelDirWatch()
     QCOMPARE(m_model->m_imageModel->count(), 1);
     QCOMPARE(m_model->m_packageModel->count(), 0);
     QCOMPARE(m_model->m_xmlModel->count(), 0);
-    QVERIFY(m_model->m_dirWatch.contains(standardPath + QStringLiteral("image.jpg")));
+    QVERIFY(m_dirWatch->contains(standardPath + QStringLiteral("image.jpg")));
 
     // Copy a package to the folder
     auto job = KIO::copy(QUrl::fromLocalFile(m_dummyPackagePath),
@@ -299,7 +353,7 @@ void ImageProxyModelTest::testImageProxyModelDirWatch()
     QCOMPARE(m_model->m_imageModel->count(), 1);
     QCOMPARE(m_model->m_packageModel->count(), 1);
     QCOMPARE(m_model->m_xmlModel->count(), 0);
-    QVERIFY(m_model->m_dirWatch.contains(standardPath + QStringLiteral("dummy")));
+    QVERIFY(m_dirWatch->contains(standardPath + QStringLiteral("dummy")));
 
     QThread::sleep(1);
 
@@ -316,8 +370,8 @@ void ImageProxyModelTest::testImageProxyModelDirWatch()
     QCOMPARE(m_model->m_imageModel->count(), 1);
     QCOMPARE(m_model->m_packageModel->count(), 1);
     QCOMPARE(m_model->m_xmlModel->count(), 1);
-    QVERIFY(m_model->m_dirWatch.contains(standardPath + QStringLiteral("xml/dummy.xml")));
-    QVERIFY(m_model->m_dirWatch.contains(standardPath + QStringLiteral("xml/.dummy.png")));
+    QVERIFY(m_dirWatch->contains(standardPath + QStringLiteral("xml/dummy.xml")));
+    QVERIFY(m_dirWatch->contains(standardPath + QStringLiteral("xml/.dummy.png")));
 
     // Test delete a file
     QFile newImageFile(standardPath + QStringLiteral("image.jpg"));
@@ -330,7 +384,7 @@ void ImageProxyModelTest::testImageProxyModelDirWatch()
     QCOMPARE(m_model->m_imageModel->count(), 0);
     QCOMPARE(m_model->m_packageModel->count(), 1);
     QCOMPARE(m_model->m_xmlModel->count(), 1);
-    QVERIFY(!m_model->m_dirWatch.contains(standardPath + QStringLiteral("image.jpg")));
+    QVERIFY(!m_dirWatch->contains(standardPath + QStringLiteral("image.jpg")));
 
     // Test delete a folder
     QVERIFY(QDir(standardPath + QStringLiteral("dummy")).removeRecursively());
@@ -342,7 +396,7 @@ void ImageProxyModelTest::testImageProxyModelDirWatch()
     QCOMPARE(m_model->m_imageModel->count(), 0);
     QCOMPARE(m_model->m_packageModel->count(), 0);
     QCOMPARE(m_model->m_xmlModel->count(), 1);
-    QVERIFY(!m_model->m_dirWatch.contains(standardPath + QStringLiteral("dummy")));
+    QVERIFY(!m_dirWatch->contains(standardPath + QStringLiteral("dummy")));
 
     // Test delete an xml file
     QFile newXmlFile(standardPath + QStringLiteral("xml/dummy.xml"));
@@ -355,7 +409,67 @@ void ImageProxyModelTest::testImageProxyModelDirWatch()
     QCOMPARE(m_model->m_imageModel->count(), 0);
     QCOMPARE(m_model->m_packageModel->count(), 0);
     QCOMPARE(m_model->m_xmlModel->count(), 0);
-    QVERIFY(!m_model->m_dirWatch.contains(standardPath + QStringLiteral("xml/dummy.xml")));
+    QVERIFY(!m_dirWatch->contains(standardPath + QStringLiteral("xml/dummy.xml")));
+
+    // Test a burst of changes is applied in one batch
+    for (int i = 0; i < 10; i++) {
+        QVERIFY(imageFile.copy(standardPath + QStringLiteral("image%1.jpg").arg(i)));
+    }
+    QVERIFY(m_countSpy->wait());
+    QCOMPARE(m_countSpy->size(), 1);
+    m_countSpy->clear();
+    QCOMPARE(m_model->count(), 10);
+    QCOMPARE(m_model->m_imageModel->count(), 10);
+
+    for (int i = 0; i < 10; i++) {
+        QVERIFY(QFile::remove(standardPath + QStringLiteral("image%1.jpg").arg(i)));
+    }
+    QVERIFY(m_countSpy->wait());
+    QCOMPARE(m_countSpy->size(), 1);
+    QCOMPARE(m_model->count(), 0);
+}
+
+void ImageProxyModelTest::testImageProxyModelWatchCount()
+{
+    DirectoryWatcher watcher;
+    const QString image = m_alternateDir.absoluteFilePath(QStringLiteral("dummy.jpg"));
+    const QString xml = m_alternateDir.absoluteFilePath(QStringLiteral("xml/dummy.xml"));
+    const QString xmlImage = m_alternateDir.absoluteFilePath(QStringLiteral("xml/.dummy.png"));
+
+    // Files in the same folder share one watch
+    watcher.addPath(xml);
+    watcher.addPath(xmlImage);
+    QCOMPARE(watcher.watchCount(), 1);
+    watcher.addPath(image);
+    QCOMPARE(watcher.watchCount(), 2);
+
+    // The same path twice needs two removals
+    watcher.addPath(image);
+    watcher.removePath(image);
+    QCOMPARE(watcher.watchCount(), 2);
+    watcher.removePath(image);
+    QCOMPARE(watcher.watchCount(), 1);
+
+    watcher.removePath(xml);
+    QCOMPARE(watcher.watchCount(), 1);
+    watcher.removePath(xmlImage);
+    QCOMPARE(watcher.watchCount(), 0);
+
+    // A root is one watch, and covers the paths inside it
+    watcher.addRoot(m_dataDir.absolutePath());
+    watcher.addRoot(m_dataDir.absolutePath());
+    QCOMPARE(watcher.watchCount(), 1);
+    watcher.addPath(m_wallpaperPath);
+    watcher.addPath(m_packagePath);
+    QCOMPARE(watcher.watchCount(), 1);
+
+    watcher.removeRoot(m_dataDir.absolutePath());
+    QCOMPARE(watcher.watchCount(), 0);
+
+    // Removing what was never added changes nothing
+    watcher.removePath(image);
+    watcher.removeRoot(m_alternateDir.absolutePath());
+    QCOMPARE(watcher.watchCount(), 0);
 }
 
 QTEST_MAIN(ImageProxyModelTest)
@@ -6,6 +6,7 @@
 */
 
 #include <QDir>
+#include <QTemporaryDir>
 #include <QtTest>
 
 #include <KPackage/PackageLoader>
@@ -22,6 +23,8 @@ private Q_SLOTS:
     void testFindPreferredSizeInPackage_data();
     void testFindPreferredSizeInPackage();
     void testPackageFinderCanFindPackages();
+    void testPackageFinderSearchesBrokenPackages();
+    void testParsePackage();
 
 private:
     QDir m_dataDir;
@@ -92,10 +95,62 @@ void PackageFinderTest::testPackageFinderCanFindPackages()
     spy.wait(10 * 1000);
     QCOMPARE(spy.size(), 1);
 
-    const auto items = spy.takeFirst().at(0).value<QList<KPackage::Package>>();
+    const auto items = spy.takeFirst().at(0).value<QList<WallpaperPackage>>();
     // Total 2 packages in the directory, but one package is broken and should not be added to the list.
     QCOMPARE(items.size(), 1);
-    QCOMPARE(items.at(0).filePath("preferred"), m_dataDir.absoluteFilePath(QStringLiteral("package/contents/images/1920x1080.jpg")));
+    QCOMPARE(items.at(0).preferred, m_dataDir.absoluteFilePath(QStringLiteral("package/contents/images/1920x1080.jpg")));
+    QCOMPARE(items.at(0).path, m_dataDir.absoluteFilePath(QStringLiteral("package")) + QDir::separator());
+    QCOMPARE(items.at(0).name, QStringLiteral("Honeywave (For test purpose, don't translate!)"));
+    QCOMPARE(items.at(0).author, QStringLiteral("Ken Vermette"));
+    QCOMPARE(items.at(0).images.size(), 19);
+}
+
+void PackageFinderTest::testPackageFinderSearchesBrokenPackages()
+{
+    // A folder with unreadable metadata is searched like any other folder
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile metadata(dir.filePath(QStringLiteral("metadata.json")));
+    QVERIFY(metadata.open(QIODevice::WriteOnly));
+    metadata.write("not json");
+    metadata.close();
+
+    const QString packagePath = dir.filePath(QStringLiteral("package"));
+    QVERIFY(QFile::link(m_dataDir.absoluteFilePath(QStringLiteral("package")), packagePath));
+
+    PackageFinder *finder = new PackageFinder({dir.path()}, QSize(1920, 1080));
+    QSignalSpy spy(finder, &PackageFinder::packageFound);
+
+    QThreadPool::globalInstance()->start(finder);
+
+    spy.wait(10 * 1000);
+    QCOMPARE(spy.size(), 1);
+
+    const auto items = spy.takeFirst().at(0).value<QList<WallpaperPackage>>();
+    QCOMPARE(items.size(), 1);
+    QCOMPARE(items.at(0).name, QStringLiteral("Honeywave (For test purpose, don't translate!)"));
+}
+
+void PackageFinderTest::testParsePackage()
+{
+    // Case 1: valid package
+    WallpaperPackage package = PackageFinder::parsePackage(m_dataDir.absoluteFilePath(QStringLiteral("package")), QSize(1280, 1024));
+    QCOMPARE(package.path, m_dataDir.absoluteFilePath(QStringLiteral("package")) + QDir::separator());
+    QCOMPARE(package.preferred, m_dataDir.absoluteFilePath(QStringLiteral("package/contents/images/1280x1024.jpg")));
+
+    // Changing the target size only picks another variant
+    PackageFinder::findPreferredImageInPackage(package, QSize(3840, 2160));
+    QCOMPARE(package.preferred, m_dataDir.absoluteFilePath(QStringLiteral("package/contents/images/3840x2160.jpg")));
+
+    // Case 2: package without images
+    package = PackageFinder::parsePackage(m_dataDir.absoluteFilePath(QStringLiteral("brokenpackage")), QSize(1920, 1080));
+    QVERIFY(package.path.isEmpty());
+    QVERIFY(package.hasMetadata);
+
+    // Case 3: not a package
+    package = PackageFinder::parsePackage(m_dataDir.absoluteFilePath(QStringLiteral("xml")), QSize(1920, 1080));
+    QVERIFY(package.path.isEmpty());
+    QVERIFY(!package.hasMetadata);
 }
 
 QTEST_MAIN(PackageFinderTest)
@@ -0,0 +1,132 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QDir>
+#include <QtTest>
+
+#include "finder/samplefinder.h"
+#include "finder/xmlfinder.h"
+
+class SampleFinderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testSampleFinderCanFindImages();
+    void testSampleFinderHistory();
+    void testSampleFinderExcluded();
+    void testSampleFinderXml();
+    void testSampleFinderSymlinkedFolder();
+
+private:
+    QString findSample(const QStringList &history, const QStringList &excluded) const;
+    QString findSample(const QStringList &paths, const QStringList &history, const QStringList &excluded) const;
+
+    QDir m_dataDir;
+    QString m_wallpaperPath;
+    QString m_packagePath;
+    QStringList m_xmlPaths;
+};
+
+void SampleFinderTest::initTestCase()
+{
+    m_dataDir = QDir(QFINDTESTDATA("testdata/default"));
+    QVERIFY(!m_dataDir.isEmpty());
+
+    m_wallpaperPath = m_dataDir.absoluteFilePath(QStringLiteral("wallpaper.jpg.jpg"));
+    m_packagePath = m_dataDir.absoluteFilePath(QStringLiteral("package")) + QDir::separator();
+
+    // timeofday.xml is a slideshow, not a wallpaper list
+    const auto items = XmlFinder::parseXml(m_dataDir.absoluteFilePath(QStringLiteral("xml/lightdark.xml")), QSize());
+    for (const WallpaperItem &item : items) {
+        m_xmlPaths.append(item.path.toString());
+    }
+    QCOMPARE(m_xmlPaths.size(), 2);
+}
+
+QString SampleFinderTest::findSample(const QStringList &history, const QStringList &excluded) const
+{
+    return findSample({m_dataDir.absolutePath()}, history, excluded);
+}
+
+QString SampleFinderTest::findSample(const QStringList &paths, const QStringList &history, const QStringList &excluded) const
+{
+    SampleFinder *finder = new SampleFinder(paths, history, excluded);
+    QSignalSpy spy(finder, &SampleFinder::sampleFound);
+
+    QThreadPool::globalInstance()->start(finder);
+
+    spy.wait(10 * 1000);
+
+    if (spy.count() != 1) {
+        return QStringLiteral("invalid");
+    }
+
+    return spy.takeFirst().at(0).toString();
+}
+
+void SampleFinderTest::testSampleFinderCanFindImages()
+{
+    /**
+     * Expected result:
+     *
+     * - wallpaper.jpg.jpg, package and the wallpapers in lightdark.xml are found.
+     * - symlinkshouldnotbefoundbythefinder.jpg is ignored.
+     * - brokenpackage and the images in package/contents/images/ are ignored.
+     */
+    for (int i = 0; i < 20; i++) {
+        const QString path = findSample({}, {});
+        QVERIFY2(path == m_wallpaperPath || path == m_packagePath || m_xmlPaths.contains(path), qPrintable(path));
+    }
+}
+
+void SampleFinderTest::testSampleFinderHistory()
+{
+    for (int i = 0; i < 20; i++) {
+        QCOMPARE(findSample(QStringList{m_wallpaperPath} + m_xmlPaths, {}), m_packagePath);
+    }
+
+    // A recent wallpaper is picked again when there is no other choice
+    const QString path = findSample(QStringList{m_wallpaperPath, m_packagePath} + m_xmlPaths, {});
+    QVERIFY2(path == m_wallpaperPath || path == m_packagePath || m_xmlPaths.contains(path), qPrintable(path));
+}
+
+void SampleFinderTest::testSampleFinderExcluded()
+{
+    for (int i = 0; i < 20; i++) {
+        QCOMPARE(findSample({}, QStringList{m_packagePath} + m_xmlPaths), m_wallpaperPath);
+    }
+
+    QCOMPARE(findSample({}, QStringList{m_wallpaperPath, m_packagePath} + m_xmlPaths), QString());
+}
+
+void SampleFinderTest::testSampleFinderXml()
+{
+    for (int i = 0; i < 20; i++) {
+        const QString path = findSample({}, {m_wallpaperPath, m_packagePath});
+        QVERIFY2(m_xmlPaths.contains(path), qPrintable(path));
+    }
+}
+
+void SampleFinderTest::testSampleFinderSymlinkedFolder()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // A symlinked folder is followed, a symlink back to the root is not
+    QVERIFY(QFile::link(m_dataDir.absoluteFilePath(QStringLiteral("xml")), dir.filePath(QStringLiteral("linked"))));
+    QVERIFY(QFile::link(dir.path(), dir.filePath(QStringLiteral("loop"))));
+
+    for (int i = 0; i < 20; i++) {
+        const QString path = findSample({dir.path()}, {}, {});
+        QVERIFY2(m_xmlPaths.contains(path), qPrintable(path));
+    }
+}
+
+QTEST_MAIN(SampleFinderTest)
+
+#include "test_samplefinder.moc"
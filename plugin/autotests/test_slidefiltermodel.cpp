@@ -10,6 +10,40 @@
 #include "../slidefiltermodel.h"
 #include "../slidemodel.h"
 
+/**
+ * A list of checked slides without any file on the disk
+ */
+class DummySlideModel : public QAbstractListModel
+{
+public:
+    explicit DummySlideModel(int count, QObject *parent = nullptr)
+        : QAbstractListModel(parent)
+        , m_count(count)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : m_count;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if (role == ImageRoles::ToggleRole) {
+            return true;
+        }
+
+        if (role == ImageRoles::PackageNameRole) {
+            return QString::number(index.row());
+        }
+
+        return QVariant();
+    }
+
+private:
+    int m_count;
+};
+
 class SlideFilterModelTest : public QObject
 {
     Q_OBJECT
@@ -23,7 +57,10 @@ private Q_SLOTS:
     void testSlideFilterModelSortingOrder_data();
     void testSlideFilterModelSortingOrder();
     void testSlideFilterModelSortingRandomOrder();
+    void testSlideFilterModelSortKeys();
     void testSlideFilterModelUncheckedSlides();
+    void testSlideFilterModelSortingRandomOrderBenchmark_data();
+    void testSlideFilterModelSortingRandomOrderBenchmark();
 
 private:
     QPointer<SlideModel> m_model = nullptr;
@@ -124,10 +161,16 @@ void SlideFilterModelTest::testSlideFilterModelSortingOrder()
     QFETCH(bool, folderFirst);
     QFETCH(QStringList, expected);
 
+    QSignalSpy readySpy(m_filterModel, &SlideFilterModel::sortKeysReady);
     m_filterModel->setSortingMode(order, folderFirst);
     m_filterModel->sort(0);
     QCOMPARE(m_filterModel->rowCount(), 3);
 
+    // The keys are read in the background
+    if (m_filterModel->sortKeysPending()) {
+        QVERIFY(readySpy.wait());
+    }
+
     for (int i = 0; i < expected.size(); i++) {
         QCOMPARE(m_filterModel->index(i, 0).data(ImageRoles::PackageNameRole).toString(), expected.at(i));
     }
@@ -159,6 +202,48 @@ void SlideFilterModelTest::testSlideFilterModelSortingRandomOrder()
     }
 }
 
+void SlideFilterModelTest::testSlideFilterModelSortKeys()
+{
+    // The keys are read in the background when the source model is set
+    SlideFilterModel filterModel(nullptr);
+    filterModel.setSortingMode(SortingMode::Alphabetical, false);
+    filterModel.sort(0);
+
+    QSignalSpy readySpy(&filterModel, &SlideFilterModel::sortKeysReady);
+    filterModel.setSourceModel(m_model);
+    QVERIFY(filterModel.sortKeysPending());
+
+    QVERIFY(readySpy.wait());
+    QVERIFY(!filterModel.sortKeysPending());
+
+    const QStringList expected{m_pathA, m_pathB, m_pathC};
+    QCOMPARE(filterModel.rowCount(), expected.size());
+
+    for (int i = 0; i < expected.size(); i++) {
+        QCOMPARE(filterModel.index(i, 0).data(ImageRoles::PackageNameRole).toString(), expected.at(i));
+    }
+
+    // The keys are kept when the sorting mode changes
+    filterModel.setSortingMode(SortingMode::ModifiedReversed, false);
+    QVERIFY(!filterModel.sortKeysPending());
+
+    // Nothing is read on the GUI thread when the keys are missing
+    SlideFilterModel randomModel(nullptr);
+    randomModel.setSortingMode(SortingMode::Random, false);
+    randomModel.setSourceModel(m_model);
+    QVERIFY(!randomModel.sortKeysPending());
+
+    QSignalSpy randomReadySpy(&randomModel, &SlideFilterModel::sortKeysReady);
+    randomModel.setSortingMode(SortingMode::Alphabetical, false);
+    QVERIFY(randomModel.sortKeysPending());
+    QVERIFY(randomReadySpy.wait());
+    QVERIFY(!randomModel.sortKeysPending());
+
+    for (int i = 0; i < expected.size(); i++) {
+        QCOMPARE(randomModel.index(i, 0).data(ImageRoles::PackageNameRole).toString(), expected.at(i));
+    }
+}
+
 void SlideFilterModelTest::testSlideFilterModelUncheckedSlides()
 {
     m_model->setUncheckedSlides({m_pathA});
@@ -171,6 +256,42 @@ void SlideFilterModelTest::testSlideFilterModelUncheckedSlides()
     QCOMPARE(m_filterModel->rowCount(), 3);
 }
 
+void SlideFilterModelTest::testSlideFilterModelSortingRandomOrderBenchmark_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("10k slides") << 10000;
+    QTest::newRow("100k slides") << 100000;
+}
+
+void SlideFilterModelTest::testSlideFilterModelSortingRandomOrderBenchmark()
+{
+    QFETCH(int, count);
+
+    DummySlideModel model(count);
+    SlideFilterModel filterModel(nullptr);
+    filterModel.setSortingMode(SortingMode::Random, false);
+    filterModel.setSourceModel(&model);
+    filterModel.sort(0);
+    QCOMPARE(filterModel.rowCount(), count);
+
+    // Reshuffles and sorts again, like at the end of every slideshow cycle
+    QBENCHMARK {
+        filterModel.invalidate();
+    }
+
+    // Still a permutation of all rows
+    std::vector<bool> found(count, false);
+
+    for (int i = 0; i < count; i++) {
+        found[filterModel.mapToSource(filterModel.index(i, 0)).row()] = true;
+    }
+
+    QVERIFY(std::all_of(found.cbegin(), found.cend(), [](bool f) {
+        return f;
+    }));
+}
+
 QTEST_MAIN(SlideFilterModelTest)
 
 #include "test_slidefiltermodel.moc"
@@ -26,6 +26,7 @@ private Q_SLOTS:
     void testSlideModelAddDirs();
     void testSlideModelRemoveDir();
     void testSlideModelSetSlidePaths();
+    void testSlideModelOverlappingDirs();
     void testSlideModelSetUncheckedSlides();
 
 private:
@@ -74,12 +75,13 @@ void SlideModelTest::init()
     QVERIFY(m_doneSpy->wait(10 * 1000));
     QCOMPARE(m_doneSpy->size(), 1);
     m_doneSpy->clear();
-    QCOMPARE(m_model->sourceModels().size(), 1);
-    QCOMPARE(m_model->m_models.size(), 1);
+    QVERIFY(m_model->m_model);
+    QCOMPARE(m_model->sourceModel(), m_model->m_model);
+    QCOMPARE(m_model->m_slidePaths.size(), 1);
     QCOMPARE(m_model->rowCount(), 4); // wallpaper.jpg.jpg, package, two xml wallpapers
 
-    QVERIFY(m_model->m_models.contains(m_dataDir.absolutePath() + QDir::separator()));
-    QCOMPARE(m_model->m_models.value(m_dataDir.absolutePath() + QDir::separator())->count(), 4);
+    QVERIFY(m_model->m_slidePaths.contains(m_dataDir.absolutePath() + QDir::separator()));
+    QCOMPARE(m_model->m_model->count(), 4);
 }
 
 void SlideModelTest::cleanup()
@@ -123,18 +125,18 @@ void SlideModelTest::testSlideModelAddDirs()
 
     // Case 1: add an image file
     auto results = m_model->addDirs({m_wallpaperPath});
-    QCOMPARE(m_model->m_models.size(), 1);
+    QCOMPARE(m_model->m_slidePaths.size(), 1);
     QCOMPARE(results.size(), 0);
 
     // Case 2: add an existing folder
     results = m_model->addDirs({m_dataDir.absolutePath()});
-    QCOMPARE(m_model->m_models.size(), 1);
+    QCOMPARE(m_model->m_slidePaths.size(), 1);
     QCOMPARE(results.size(), 0);
 
     // Case 3: add a new folder
     results = m_model->addDirs({m_alternateDir.absolutePath()});
     QCOMPARE(results.size(), 1);
-    QCOMPARE(m_model->m_models.size(), 2);
+    QCOMPARE(m_model->m_slidePaths.size(), 2);
     QVERIFY(m_doneSpy->wait());
     QCOMPARE(m_doneSpy->size(), 1);
     m_doneSpy->clear();
@@ -144,15 +146,14 @@ void SlideModelTest::testSlideModelAddDirs()
 void SlideModelTest::testSlideModelRemoveDir()
 {
     // Case 1: remove a not added dir
-    m_model->removeDir(m_alternateDir.absolutePath());
-    QCOMPARE(m_model->m_models.size(), 1);
-    QCOMPARE(m_model->m_loaded, 1);
+    QVERIFY(m_model->removeDir(m_alternateDir.absolutePath()).isEmpty());
+    QCOMPARE(m_model->m_slidePaths.size(), 1);
     QCOMPARE(m_model->rowCount(), 4);
 
     // Case 2: remove an existing dir
-    m_model->removeDir(m_dataDir.absolutePath());
-    QCOMPARE(m_model->m_models.size(), 0);
-    QCOMPARE(m_model->m_loaded, 0);
+    QVERIFY(!m_model->removeDir(m_dataDir.absolutePath()).isEmpty());
+    QCOMPARE(m_model->m_slidePaths.size(), 0);
+    QVERIFY(!m_model->m_model);
     QCOMPARE(m_model->rowCount(), 0);
 }
 
@@ -160,25 +161,42 @@ void SlideModelTest::testSlideModelSetSlidePaths()
 {
     // Case 1: list is empty
     m_model->setSlidePaths({});
-    QCOMPARE(m_model->m_models.size(), 0);
-    QCOMPARE(m_model->m_loaded, 0);
+    QCOMPARE(m_model->m_slidePaths.size(), 0);
+    QVERIFY(!m_model->m_model);
 
     // Case 2: path is invalid
     m_model->setSlidePaths({QString()});
-    QCOMPARE(m_model->m_models.size(), 0);
-    QCOMPARE(m_model->m_loaded, 0);
+    QCOMPARE(m_model->m_slidePaths.size(), 0);
+    QVERIFY(!m_model->m_model);
 
     // Case 3: path is valid
     m_model->setSlidePaths({m_alternateDir.absolutePath()});
-    QCOMPARE(m_model->m_models.size(), 1);
+    QCOMPARE(m_model->m_slidePaths.size(), 1);
     QVERIFY(m_doneSpy->wait(10 * 1000));
     QCOMPARE(m_doneSpy->size(), 1);
     m_doneSpy->clear();
-    QCOMPARE(m_model->sourceModels().size(), 1);
-    QCOMPARE(m_model->m_models.size(), 1);
+    QVERIFY(m_model->m_model);
     QCOMPARE(m_model->rowCount(), 3);
 }
 
+void SlideModelTest::testSlideModelOverlappingDirs()
+{
+    // A child folder is not scanned again
+    const QString packageDir = m_packagePath + QDir::separator();
+    const auto results = m_model->addDirs({m_dataDir.absoluteFilePath(QStringLiteral("xml"))});
+    QCOMPARE(results.size(), 1);
+    QVERIFY(m_doneSpy->wait());
+    QCOMPARE(m_model->rowCount(), 4);
+    QCOMPARE(m_model->m_model->roots().size(), 2);
+    QCOMPARE(ImageProxyModel::minimalRoots(m_model->m_model->roots()).size(), 1);
+
+    // Removing the parent folder keeps the rows of the child folder
+    m_model->removeDir(m_dataDir.absolutePath());
+    QCOMPARE(m_model->rowCount(), 2); // Two xml wallpapers
+    QCOMPARE(m_model->indexOf(packageDir), -1);
+    QVERIFY(m_model->indexOf(m_wallpaperPath) < 0);
+}
+
 void SlideModelTest::testSlideModelSetUncheckedSlides()
 {
     QPersistentModelIndex idx = m_model->index(0, 0);
@@ -188,6 +206,27 @@ void SlideModelTest::testSlideModelSetUncheckedSlides()
 
     QVERIFY(m_model->setData(idx, true, ImageRoles::ToggleRole));
     QCOMPARE(idx.data(ImageRoles::ToggleRole), true);
+
+    // The checked state follows the rows when other rows are added or removed
+    const QString packageName = m_model->index(m_model->indexOf(m_wallpaperPath), 0).data(ImageRoles::PackageNameRole).toString();
+    m_model->setUncheckedSlides({packageName});
+    QVERIFY(!m_model->isChecked(m_model->indexOf(m_wallpaperPath)));
+
+    m_model->addDirs({m_alternateDir.absolutePath()});
+    QVERIFY(m_doneSpy->wait());
+    QCOMPARE(m_model->rowCount(), 7);
+
+    for (int row = 0; row < m_model->rowCount(); row++) {
+        const bool checked = m_model->index(row, 0).data(ImageRoles::PackageNameRole).toString() != packageName;
+        QCOMPARE(m_model->isChecked(row), checked);
+        QCOMPARE(m_model->index(row, 0).data(ImageRoles::ToggleRole).toBool(), checked);
+    }
+
+    m_model->removeDir(m_alternateDir.absolutePath());
+    QCOMPARE(m_model->rowCount(), 4);
+    QCOMPARE(m_model->m_checkedRows.size(), 4);
+    QVERIFY(!m_model->isChecked(m_model->indexOf(m_wallpaperPath)));
+    QCOMPARE(std::count(m_model->m_checkedRows.cbegin(), m_model->m_checkedRows.cend(), false), 1);
 }
 
 QTEST_MAIN(SlideModelTest)
@@ -0,0 +1,256 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QStandardItemModel>
+#include <QtTest>
+
+#include "../model/imageroles.h"
+#include "../slidefiltermodel.h"
+#include "../slideplaylist.h"
+
+class SlidePlaylistTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testSlidePlaylistShuffled();
+    void testSlidePlaylistSorted();
+    void testSlidePlaylistFirst();
+    void testSlidePlaylistRowsChanged();
+    void testSlidePlaylistSortedRowsChanged();
+    void testSlidePlaylistUncheckedSlides();
+    void testSlidePlaylistRestore();
+
+private:
+    void appendSlide(const QString &name);
+
+    QPointer<QStandardItemModel> m_model = nullptr;
+    QPointer<SlideFilterModel> m_filterModel = nullptr;
+    QPointer<SlidePlaylist> m_playlist = nullptr;
+};
+
+void SlidePlaylistTest::init()
+{
+    m_model = new QStandardItemModel(this);
+
+    for (const QString &name : {QStringLiteral("c"), QStringLiteral("a"), QStringLiteral("e"), QStringLiteral("b"), QStringLiteral("d")}) {
+        appendSlide(name);
+    }
+
+    m_filterModel = new SlideFilterModel(this);
+    m_filterModel->setSourceModel(m_model);
+    m_filterModel->sort(0);
+    m_playlist = new SlidePlaylist(m_filterModel, this);
+}
+
+void SlidePlaylistTest::cleanup()
+{
+    delete m_playlist;
+    delete m_filterModel;
+    delete m_model;
+}
+
+void SlidePlaylistTest::appendSlide(const QString &name)
+{
+    auto item = new QStandardItem(name);
+    item->setData(name, ImageRoles::PackageNameRole);
+    item->setData(true, ImageRoles::ToggleRole);
+    m_model->appendRow(item);
+}
+
+void SlidePlaylistTest::testSlidePlaylistShuffled()
+{
+    QSignalSpy layoutSpy(m_filterModel, &SlideFilterModel::layoutChanged);
+
+    m_playlist->setShuffled(true);
+    m_playlist->reset();
+    QCOMPARE(m_playlist->count(), 5);
+
+    QString previous;
+
+    for (int cycle = 0; cycle < 10; cycle++) {
+        QSet<QString> slides;
+
+        for (int i = 0; i < 5; i++) {
+            const QString slide = m_playlist->next();
+            // Every slide once per cycle, and no slide twice in a row
+            QVERIFY(!slides.contains(slide));
+            QVERIFY(slide != previous);
+            slides.insert(slide);
+            previous = slide;
+        }
+
+        QCOMPARE(slides.size(), 5);
+    }
+
+    // Playing does not touch the model
+    QCOMPARE(layoutSpy.size(), 0);
+}
+
+void SlidePlaylistTest::testSlidePlaylistSorted()
+{
+    QSignalSpy readySpy(m_filterModel, &SlideFilterModel::sortKeysReady);
+    m_filterModel->setSortingMode(SortingMode::Alphabetical, false);
+    m_filterModel->sort(0);
+
+    if (m_filterModel->sortKeysPending()) {
+        QVERIFY(readySpy.wait());
+    }
+
+    m_playlist->setShuffled(false);
+    m_playlist->reset();
+
+    QStringList slides;
+
+    for (int i = 0; i < 6; i++) {
+        slides.append(m_playlist->next());
+    }
+
+    // The sort keys of items without a local file are equal, so the order of the model is used
+    QStringList expected;
+
+    for (int i = 0; i < m_filterModel->rowCount(); i++) {
+        expected.append(m_filterModel->index(i, 0).data(ImageRoles::PackageNameRole).toString());
+    }
+    expected.append(expected.constFirst());
+
+    QCOMPARE(slides, expected);
+}
+
+void SlidePlaylistTest::testSlidePlaylistFirst()
+{
+    m_playlist->setShuffled(true);
+    m_playlist->reset(QStringLiteral("e"));
+
+    QCOMPARE(m_playlist->next(), QStringLiteral("e"));
+}
+
+void SlidePlaylistTest::testSlidePlaylistRowsChanged()
+{
+    m_playlist->setShuffled(true);
+    m_playlist->reset();
+
+    const QString first = m_playlist->next();
+    const QString second = m_playlist->next();
+
+    // Remove a played and a not played slide, then add one
+    QStringList removed{first};
+
+    for (int row = 0; row < m_model->rowCount(); row++) {
+        const QString name = m_model->item(row)->text();
+
+        if (name != first && name != second) {
+            removed.append(name);
+            break;
+        }
+    }
+
+    for (const QString &name : std::as_const(removed)) {
+        m_model->removeRow(m_model->findItems(name).constFirst()->row());
+    }
+    appendSlide(QStringLiteral("f"));
+    m_model->insertRow(0, new QStandardItem(QStringLiteral("g")));
+    m_model->item(0)->setData(QStringLiteral("g"), ImageRoles::PackageNameRole);
+    m_model->item(0)->setData(true, ImageRoles::ToggleRole);
+
+    QCOMPARE(m_playlist->count(), 5);
+
+    // The rest of the cycle has all the other slides
+    QSet<QString> rest;
+
+    for (int i = 0; i < 4; i++) {
+        rest.insert(m_playlist->next());
+    }
+
+    QCOMPARE(rest.size(), 4);
+    QVERIFY(rest.contains(QStringLiteral("f")));
+    QVERIFY(rest.contains(QStringLiteral("g")));
+    QVERIFY(!rest.contains(second));
+
+    for (const QString &name : std::as_const(removed)) {
+        QVERIFY(!rest.contains(name));
+    }
+}
+
+void SlidePlaylistTest::testSlidePlaylistSortedRowsChanged()
+{
+    m_playlist->setShuffled(false);
+    m_playlist->reset();
+
+    m_playlist->next();
+    const QString current = m_playlist->next();
+
+    // Inserting a slide in front moves the row of the current slide
+    m_model->insertRow(0, new QStandardItem(QStringLiteral("g")));
+    m_model->item(0)->setData(QStringLiteral("g"), ImageRoles::PackageNameRole);
+    m_model->item(0)->setData(true, ImageRoles::ToggleRole);
+
+    QStringList order;
+
+    for (int i = 0; i < m_filterModel->rowCount(); i++) {
+        order.append(m_filterModel->index(i, 0).data(ImageRoles::PackageNameRole).toString());
+    }
+
+    // The playlist continues after the current slide in the new order
+    QCOMPARE(m_playlist->next(), order.at((order.indexOf(current) + 1) % order.size()));
+    QCOMPARE(m_playlist->count(), 6);
+}
+
+void SlidePlaylistTest::testSlidePlaylistUncheckedSlides()
+{
+    m_playlist->setShuffled(true);
+    m_playlist->reset();
+
+    m_model->findItems(QStringLiteral("a")).constFirst()->setData(false, ImageRoles::ToggleRole);
+
+    for (int i = 0; i < 20; i++) {
+        QVERIFY(m_playlist->next() != QStringLiteral("a"));
+    }
+}
+
+void SlidePlaylistTest::testSlidePlaylistRestore()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QStringList paths;
+
+    for (const QString &name : {QStringLiteral("1.jpg"), QStringLiteral("2.jpg"), QStringLiteral("3.jpg")}) {
+        QFile file(dir.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        paths.append(file.fileName());
+    }
+
+    const QString missing = dir.filePath(QStringLiteral("missing.jpg"));
+
+    m_playlist->setShuffled(true);
+    m_playlist->restore({paths.at(1), missing, paths.at(0)});
+    QCOMPARE(m_playlist->upcoming(2), (QStringList{paths.at(1), missing}));
+
+    // The saved order is played before the slides are scanned
+    QCOMPARE(m_playlist->next(), paths.at(1));
+
+    for (const QString &path : std::as_const(paths)) {
+        appendSlide(path);
+    }
+
+    // The current slide is shown again, then the rest of the saved order
+    m_playlist->reset(paths.at(1));
+    QCOMPARE(m_playlist->count(), 8);
+    QCOMPARE(m_playlist->next(), paths.at(1));
+    QCOMPARE(m_playlist->next(), paths.at(0));
+
+    const QStringList upcoming = m_playlist->upcoming(100);
+    QCOMPARE(upcoming.size(), 6);
+    QVERIFY(!upcoming.contains(missing));
+}
+
+QTEST_MAIN(SlidePlaylistTest)
+
+#include "test_slideplaylist.moc"
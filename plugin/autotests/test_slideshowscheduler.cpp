@@ -0,0 +1,172 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QtTest>
+
+#include "slideshowscheduler.h"
+#include "visibilitysource.h"
+
+class StubVisibilitySource : public VisibilitySource
+{
+    Q_OBJECT
+
+public:
+    bool isVisible() const override
+    {
+        return m_visible;
+    }
+
+    void setVisible(bool visible)
+    {
+        m_visible = visible;
+        Q_EMIT visibleChanged(visible);
+    }
+
+private:
+    bool m_visible = true;
+};
+
+class SlideshowSchedulerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testSlideshowSchedulerTimeout();
+    void testSlideshowSchedulerDeferred();
+    void testSlideshowSchedulerNotDue();
+    void testSlideshowSchedulerOutputVisible();
+    void testSlideshowSchedulerTimerType();
+
+private:
+    QPointer<SlideshowScheduler> m_scheduler;
+    QPointer<StubVisibilitySource> m_source;
+    QSignalSpy *m_timeoutSpy = nullptr;
+    QSignalSpy *m_visibleSpy = nullptr;
+};
+
+void SlideshowSchedulerTest::init()
+{
+    m_scheduler = new SlideshowScheduler(this);
+    m_source = new StubVisibilitySource;
+    m_scheduler->setVisibilitySource(m_source);
+
+    m_timeoutSpy = new QSignalSpy(m_scheduler, &SlideshowScheduler::timeout);
+    m_visibleSpy = new QSignalSpy(m_scheduler, &SlideshowScheduler::visibleChanged);
+}
+
+void SlideshowSchedulerTest::cleanup()
+{
+    delete m_timeoutSpy;
+    delete m_visibleSpy;
+    delete m_scheduler;
+}
+
+void SlideshowSchedulerTest::testSlideshowSchedulerTimeout()
+{
+    QVERIFY(m_scheduler->isVisible());
+
+    m_scheduler->start(50);
+    QVERIFY(m_scheduler->isActive());
+
+    QVERIFY(m_timeoutSpy->wait(5000));
+    QCOMPARE(m_timeoutSpy->size(), 1);
+    QVERIFY(!m_scheduler->isActive());
+
+    // Single shot
+    QTest::qWait(200);
+    QCOMPARE(m_timeoutSpy->size(), 1);
+}
+
+void SlideshowSchedulerTest::testSlideshowSchedulerDeferred()
+{
+    m_scheduler->start(50);
+    m_source->setVisible(false);
+    QVERIFY(!m_scheduler->isVisible());
+    QCOMPARE(m_visibleSpy->size(), 1);
+    QCOMPARE(m_visibleSpy->takeFirst().at(0).toBool(), false);
+
+    // Nothing happens while hidden, even long after the slide was due
+    QTest::qWait(300);
+    QCOMPARE(m_timeoutSpy->size(), 0);
+    QVERIFY(m_scheduler->isActive());
+
+    // Restarting while hidden is deferred too
+    m_scheduler->start(50);
+    QTest::qWait(300);
+    QCOMPARE(m_timeoutSpy->size(), 0);
+
+    // Catches up with exactly one slide, right away
+    m_source->setVisible(true);
+    QCOMPARE(m_visibleSpy->size(), 1);
+    QCOMPARE(m_visibleSpy->takeFirst().at(0).toBool(), true);
+    QCOMPARE(m_timeoutSpy->size(), 1);
+    QVERIFY(!m_scheduler->isActive());
+
+    QTest::qWait(200);
+    QCOMPARE(m_timeoutSpy->size(), 1);
+}
+
+void SlideshowSchedulerTest::testSlideshowSchedulerNotDue()
+{
+    m_scheduler->start(400);
+    m_source->setVisible(false);
+    m_source->setVisible(true);
+
+    // The remaining time is kept
+    QCOMPARE(m_timeoutSpy->size(), 0);
+    QVERIFY(m_scheduler->isActive());
+    QVERIFY(m_timeoutSpy->wait(5000));
+    QCOMPARE(m_timeoutSpy->size(), 1);
+
+    // A stopped timer does not catch up
+    m_scheduler->start(50);
+    m_source->setVisible(false);
+    m_scheduler->stop();
+    QTest::qWait(200);
+    m_source->setVisible(true);
+    QCOMPARE(m_timeoutSpy->size(), 1);
+}
+
+void SlideshowSchedulerTest::testSlideshowSchedulerOutputVisible()
+{
+    m_scheduler->start(50);
+    m_scheduler->setOutputVisible(false);
+    QVERIFY(!m_scheduler->isVisible());
+
+    // Both the output and the session must be visible
+    m_source->setVisible(false);
+    m_scheduler->setOutputVisible(true);
+    QVERIFY(!m_scheduler->isVisible());
+    QCOMPARE(m_visibleSpy->size(), 1);
+
+    QTest::qWait(200);
+    QCOMPARE(m_timeoutSpy->size(), 0);
+
+    m_source->setVisible(true);
+    QVERIFY(m_scheduler->isVisible());
+    QCOMPARE(m_visibleSpy->size(), 2);
+    QCOMPARE(m_timeoutSpy->size(), 1);
+
+    // Without a source only the output matters
+    m_scheduler->setVisibilitySource(nullptr);
+    QVERIFY(m_source.isNull());
+    QVERIFY(m_scheduler->isVisible());
+}
+
+void SlideshowSchedulerTest::testSlideshowSchedulerTimerType()
+{
+    m_scheduler->start(10 * 1000);
+    QCOMPARE(m_scheduler->timerType(), Qt::CoarseTimer);
+
+    m_scheduler->start(10 * 60 * 1000);
+    QCOMPARE(m_scheduler->timerType(), Qt::VeryCoarseTimer);
+}
+
+QTEST_MAIN(SlideshowSchedulerTest)
+
+#include "test_slideshowscheduler.moc"
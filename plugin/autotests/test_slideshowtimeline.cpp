@@ -0,0 +1,240 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QDir>
+#include <QtTest>
+
+#include "finder/xmlfinder.h"
+#include "slideshowtimeline.h"
+
+class SlideshowTimelineTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testSlideshowTimelineFrame();
+    void testSlideshowTimelineBoundary();
+    void testSlideshowTimelineInvalid();
+    void testSlideshowTimelineStartTime();
+    void testSlideshowTimelineLoad();
+    void testSlideshowTimelineBenchmark_data();
+    void testSlideshowTimelineBenchmark();
+
+private:
+    static SlideshowItemData staticItem(const QString &file, quint64 duration);
+    static SlideshowItemData transitionItem(const QString &from, const QString &to, quint64 duration);
+
+    QDir m_dataDir;
+    SlideshowData m_data;
+};
+
+SlideshowItemData SlideshowTimelineTest::staticItem(const QString &file, quint64 duration)
+{
+    SlideshowItemData item;
+    item.dataType = 0;
+    item.duration = duration;
+    item.file = file;
+
+    return item;
+}
+
+SlideshowItemData SlideshowTimelineTest::transitionItem(const QString &from, const QString &to, quint64 duration)
+{
+    SlideshowItemData item;
+    item.dataType = 1;
+    item.duration = duration;
+    item.from = from;
+    item.to = to;
+
+    return item;
+}
+
+void SlideshowTimelineTest::initTestCase()
+{
+    m_dataDir = QDir(QFINDTESTDATA("testdata/default/xml"));
+    QVERIFY(!m_dataDir.isEmpty());
+
+    /**
+     * 0       100        200   300  400
+     * | light | to dark  |dark | to light
+     */
+    m_data.starttime = QDateTime::currentDateTime().addDays(-1);
+    m_data.data = {
+        staticItem(QStringLiteral("light"), 100),
+        transitionItem(QStringLiteral("light"), QStringLiteral("dark"), 100),
+        staticItem(QStringLiteral("empty"), 0),
+        staticItem(QStringLiteral("dark"), 100),
+        transitionItem(QStringLiteral("dark"), QStringLiteral("light"), 100),
+    };
+}
+
+void SlideshowTimelineTest::testSlideshowTimelineFrame()
+{
+    const SlideshowTimeline timeline(m_data);
+
+    QVERIFY(timeline.isValid());
+    QCOMPARE(timeline.count(), 5);
+    QCOMPARE(timeline.totalTime(), qint64(400));
+    QCOMPARE(timeline.staticFiles(), (QStringList{QStringLiteral("light"), QStringLiteral("empty"), QStringLiteral("dark")}));
+
+    SlideshowTimeline::Frame frame = timeline.frameAtPosition(0);
+    QVERIFY(!frame.isTransition);
+    QCOMPARE(frame.file, QStringLiteral("light"));
+    QCOMPARE(frame.start, qint64(0));
+    QCOMPARE(frame.end, qint64(100));
+
+    frame = timeline.frameAtPosition(99);
+    QCOMPARE(frame.file, QStringLiteral("light"));
+
+    frame = timeline.frameAtPosition(150);
+    QVERIFY(frame.isTransition);
+    QCOMPARE(frame.file, QStringLiteral("light"));
+    QCOMPARE(frame.to, QStringLiteral("dark"));
+    QCOMPARE(frame.progress, 0.5);
+
+    // An item without a duration is never shown
+    frame = timeline.frameAtPosition(200);
+    QVERIFY(!frame.isTransition);
+    QCOMPARE(frame.file, QStringLiteral("dark"));
+    QCOMPARE(frame.start, qint64(200));
+    QCOMPARE(frame.end, qint64(300));
+
+    frame = timeline.frameAtPosition(375);
+    QVERIFY(frame.isTransition);
+    QCOMPARE(frame.to, QStringLiteral("light"));
+    QCOMPARE(frame.progress, 0.75);
+
+    // The cycle repeats
+    QCOMPARE(timeline.frameAtPosition(400 * 7 + 150).progress, 0.5);
+    QCOMPARE(timeline.frameAtPosition(-250).progress, 0.5);
+
+    // By time
+    const QDateTime time = timeline.startTime(QDateTime::currentDateTime()).addSecs(400 * 3 + 250);
+    frame = timeline.frameAt(time);
+    QCOMPARE(frame.file, QStringLiteral("dark"));
+    QCOMPARE(frame.position, qint64(250));
+}
+
+void SlideshowTimelineTest::testSlideshowTimelineBoundary()
+{
+    const SlideshowTimeline timeline(m_data);
+    const QDateTime start = timeline.startTime(QDateTime::currentDateTime()).addSecs(400 * 5);
+
+    QCOMPARE(timeline.nextBoundary(start), start.addSecs(100));
+    QCOMPARE(timeline.nextBoundary(start.addSecs(120)), start.addSecs(200));
+    QCOMPARE(timeline.nextBoundary(start.addSecs(200)), start.addSecs(300));
+    // The last item ends with the cycle
+    QCOMPARE(timeline.nextBoundary(start.addSecs(399)), start.addSecs(400));
+}
+
+void SlideshowTimelineTest::testSlideshowTimelineInvalid()
+{
+    const SlideshowTimeline empty;
+    QVERIFY(!empty.isValid());
+    QVERIFY(!empty.frameAtPosition(0).isTransition);
+    QVERIFY(empty.frameAtPosition(0).file.isEmpty());
+    QVERIFY(!empty.nextBoundary(QDateTime::currentDateTime()).isValid());
+
+    SlideshowData data;
+    data.data = {staticItem(QStringLiteral("light"), 0)};
+    QVERIFY(!SlideshowTimeline(data).isValid());
+
+    QVERIFY(!SlideshowTimeline::load(m_dataDir.absoluteFilePath(QStringLiteral("thisisnotawallpaper.txt")), QSize(1920, 1080)));
+    QVERIFY(!SlideshowTimeline::load(m_dataDir.absoluteFilePath(QStringLiteral("doesnotexist.xml")), QSize(1920, 1080)));
+}
+
+void SlideshowTimelineTest::testSlideshowTimelineStartTime()
+{
+    // Day from 8 AM to 6 PM, night until 8 AM
+    SlideshowData data;
+    data.starttime = QDateTime::currentDateTime().addYears(1);
+    data.starttime.setTime(QTime(8, 0));
+    data.data = {
+        staticItem(QStringLiteral("light"), 10 * 3600),
+        staticItem(QStringLiteral("dark"), 14 * 3600),
+    };
+
+    // A start in the future falls back to the time of day at every lookup, so it holds across DST changes
+    const SlideshowTimeline future(data);
+    QVERIFY(future.isValid());
+
+    for (QDate date = QDate::currentDate(); date < QDate::currentDate().addYears(1); date = date.addDays(7)) {
+        QCOMPARE(future.startTime(date.startOfDay()), QDateTime(date.addDays(-1), QTime(8, 0)));
+        QCOMPARE(future.frameAt(QDateTime(date, QTime(12, 0))).file, QStringLiteral("light"));
+        QCOMPARE(future.frameAt(QDateTime(date, QTime(20, 0))).file, QStringLiteral("dark"));
+        QCOMPARE(future.nextBoundary(QDateTime(date, QTime(12, 0))), QDateTime(date, QTime(18, 0)));
+    }
+
+    // Without a start, the cycle starts at 0:00
+    data.starttime = QDateTime();
+    const SlideshowTimeline unset(data);
+    QVERIFY(unset.isValid());
+    const QDate today = QDate::currentDate();
+    QCOMPARE(unset.startTime(QDateTime(today, QTime(12, 0))), today.addDays(-1).startOfDay());
+    QCOMPARE(unset.frameAt(QDateTime(today, QTime(9, 0))).file, QStringLiteral("light"));
+    QCOMPARE(unset.frameAt(QDateTime(today, QTime(11, 0))).file, QStringLiteral("dark"));
+}
+
+void SlideshowTimelineTest::testSlideshowTimelineLoad()
+{
+    const QString path = m_dataDir.absoluteFilePath(QStringLiteral("timeofday.xml"));
+    const auto timeline = SlideshowTimeline::load(path, QSize(1920, 1080));
+
+    QVERIFY(timeline);
+    QCOMPARE(timeline->count(), 4);
+    QCOMPARE(timeline->totalTime(), qint64(86400));
+    QCOMPARE(timeline->startTime(QDateTime::currentDateTime()).time(), QTime(8, 0));
+
+    // Day from 8 AM to 6 PM
+    const QDateTime day = timeline->startTime(QDateTime::currentDateTime()).addDays(30);
+    const SlideshowTimeline::Frame frame = timeline->frameAt(day.addSecs(4 * 3600));
+    QVERIFY(!frame.isTransition);
+    QCOMPARE(frame.file, m_dataDir.absoluteFilePath(QStringLiteral(".light.png")));
+
+    // 7 PM, halfway from day to night
+    QCOMPARE(timeline->frameAt(day.addSecs(11 * 3600)).progress, 0.5);
+
+    // Shared until the file changes
+    QCOMPARE(SlideshowTimeline::load(path, QSize(1920, 1080)), timeline);
+}
+
+void SlideshowTimelineTest::testSlideshowTimelineBenchmark_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("1k items") << 1000;
+    QTest::newRow("100k items") << 100000;
+}
+
+void SlideshowTimelineTest::testSlideshowTimelineBenchmark()
+{
+    QFETCH(int, count);
+
+    // A minute-level time-lapse
+    SlideshowData data;
+    data.starttime = QDateTime::currentDateTime().addDays(-1);
+
+    for (int i = 0; i < count; i++) {
+        data.data.append(staticItem(QStringLiteral("frame%1.jpg").arg(i), 30));
+        data.data.append(transitionItem(QStringLiteral("frame%1.jpg").arg(i), QStringLiteral("frame%1.jpg").arg(i + 1), 30));
+    }
+
+    const SlideshowTimeline timeline(data);
+    QCOMPARE(timeline.count(), count * 2);
+
+    qint64 position = 0;
+
+    QBENCHMARK {
+        const SlideshowTimeline::Frame frame = timeline.frameAtPosition(position);
+        QVERIFY(frame.end > frame.position);
+        position += 7919;
+    }
+}
+
+QTEST_MAIN(SlideshowTimelineTest)
+
+#include "test_slideshowtimeline.moc"
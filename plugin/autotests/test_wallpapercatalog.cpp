@@ -0,0 +1,277 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QDebug>
+#include <QtTest>
+
+#include "../finder/xmlfinder.h"
+#include "../model/catalogroot.h"
+#include "../model/imageproxymodel.h"
+#include "../model/imagelistmodel.h"
+#include "../model/wallpapercatalog.h"
+
+class WallpaperCatalogTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void testWallpaperCatalogShare();
+    void testWallpaperCatalogRelease();
+    void testWallpaperCatalogChildFolder();
+    void testWallpaperCatalogTargetSize();
+    void testWallpaperCatalogPendingChanges();
+    void testWallpaperCatalogChangeRoots();
+    void testWallpaperCatalogCoveredRoot();
+
+private:
+    void waitForLoaded(CatalogRoot *root);
+    void waitForLoaded(ImageProxyModel *model);
+
+    QDir m_dataDir;
+    QDir m_alternateDir;
+    QSize m_targetSize;
+};
+
+void WallpaperCatalogTest::initTestCase()
+{
+    qRegisterMetaType<QList<WallpaperItem>>();
+
+    m_dataDir = QDir(QFINDTESTDATA("testdata/default"));
+    m_alternateDir = QDir(QFINDTESTDATA("testdata/alternate"));
+    QVERIFY(!m_dataDir.isEmpty());
+    QVERIFY(!m_alternateDir.isEmpty());
+
+    m_targetSize = QSize(1920, 1080);
+
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void WallpaperCatalogTest::cleanup()
+{
+    // Models are deleted later, and so are the folders they release
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    QCOMPARE(WallpaperCatalog::self()->count(), 0);
+}
+
+void WallpaperCatalogTest::waitForLoaded(CatalogRoot *root)
+{
+    QSignalSpy changedSpy(root, &CatalogRoot::changed);
+
+    while (!root->isLoaded()) {
+        QVERIFY(changedSpy.wait(10 * 1000));
+    }
+}
+
+void WallpaperCatalogTest::waitForLoaded(ImageProxyModel *model)
+{
+    QSignalSpy loadingSpy(model, &ImageProxyModel::loadingChanged);
+
+    while (model->loading()) {
+        QVERIFY(loadingSpy.wait(10 * 1000));
+    }
+}
+
+void WallpaperCatalogTest::testWallpaperCatalogShare()
+{
+    WallpaperCatalog *catalog = WallpaperCatalog::self();
+
+    CatalogRoot *root1 = catalog->acquire(m_dataDir.absolutePath());
+    // The same folder written differently
+    CatalogRoot *root2 = catalog->acquire(m_dataDir.absolutePath() + QDir::separator());
+    QCOMPARE(root1, root2);
+    QCOMPARE(catalog->count(), 1);
+    QVERIFY(root1->scanning());
+
+    CatalogRoot *root3 = catalog->acquire(m_alternateDir.absolutePath());
+    QVERIFY(root1 != root3);
+    QCOMPARE(catalog->count(), 2);
+
+    waitForLoaded(root1);
+    QCOMPARE(root1->images().size(), 1);
+    QCOMPARE(root1->packages().size(), 1);
+    QCOMPARE(root1->xmlItems().size(), 2);
+
+    // A loaded folder is handed out as is
+    QCOMPARE(catalog->acquire(m_dataDir.absolutePath()), root1);
+    QVERIFY(!root1->scanning());
+
+    catalog->release(root1);
+    catalog->release(root1);
+    catalog->release(root1);
+    catalog->release(root3);
+}
+
+void WallpaperCatalogTest::testWallpaperCatalogRelease()
+{
+    WallpaperCatalog *catalog = WallpaperCatalog::self();
+
+    QPointer<CatalogRoot> root = catalog->acquire(m_dataDir.absolutePath());
+    catalog->acquire(m_dataDir.absolutePath());
+
+    catalog->release(root);
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    QVERIFY(root);
+    QCOMPARE(catalog->count(), 1);
+
+    catalog->release(root);
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    QVERIFY(!root);
+    QCOMPARE(catalog->count(), 0);
+
+    // Models release their folders when they are deleted
+    auto model = new ImageProxyModel({m_dataDir.absolutePath(), m_alternateDir.absolutePath()}, m_targetSize, this);
+    QCOMPARE(catalog->count(), 2);
+
+    delete model;
+    QCOMPARE(catalog->count(), 0);
+}
+
+void WallpaperCatalogTest::testWallpaperCatalogChildFolder()
+{
+    WallpaperCatalog *catalog = WallpaperCatalog::self();
+
+    CatalogRoot *parent = catalog->acquire(m_dataDir.absolutePath());
+    waitForLoaded(parent);
+
+    // A folder inside a loaded folder is not scanned again
+    CatalogRoot *child = catalog->acquire(m_dataDir.absoluteFilePath(QStringLiteral("xml")));
+    QVERIFY(child != parent);
+    QVERIFY(child->isLoaded());
+    QVERIFY(!child->scanning());
+    QCOMPARE(child->images().size(), 0);
+    QCOMPARE(child->packages().size(), 0);
+    QCOMPARE(child->xmlItems().size(), 2);
+
+    catalog->release(child);
+    catalog->release(parent);
+}
+
+void WallpaperCatalogTest::testWallpaperCatalogTargetSize()
+{
+    WallpaperCatalog *catalog = WallpaperCatalog::self();
+
+    // The folder is shared by all sizes
+    auto model1 = new ImageProxyModel({m_dataDir.absolutePath()}, QSize(1280, 1024), this);
+    auto model2 = new ImageProxyModel({m_dataDir.absolutePath()}, QSize(3840, 2160), this);
+    QCOMPARE(catalog->count(), 1);
+
+    waitForLoaded(model1);
+    waitForLoaded(model2);
+
+    // Each model picks the preferred image for its own size
+    const QString packagePath = m_dataDir.absoluteFilePath(QStringLiteral("package"));
+    const QModelIndex idx1 = model1->index(model1->indexOf(packagePath), 0);
+    const QModelIndex idx2 = model2->index(model2->indexOf(packagePath), 0);
+    QVERIFY(idx1.data(ImageRoles::PathRole).toUrl().toLocalFile().endsWith(QLatin1String("1280x1024.jpg")));
+    QVERIFY(idx2.data(ImageRoles::PathRole).toUrl().toLocalFile().endsWith(QLatin1String("3840x2160.jpg")));
+
+    // A new size picks the images again without scanning
+    QSignalSpy dataSpy(model1, &ImageProxyModel::dataChanged);
+    Q_EMIT model1->targetSizeChanged(QSize(3840, 2160));
+    QVERIFY(!model1->loading());
+    QVERIFY(!dataSpy.empty());
+    QVERIFY(idx1.data(ImageRoles::PathRole).toUrl().toLocalFile().endsWith(QLatin1String("3840x2160.jpg")));
+
+    delete model1;
+    delete model2;
+}
+
+void WallpaperCatalogTest::testWallpaperCatalogPendingChanges()
+{
+    const QString wallpaperPath = m_dataDir.absoluteFilePath(QStringLiteral("wallpaper.jpg.jpg"));
+    const QString dummyWallpaperPath = m_alternateDir.absoluteFilePath(QStringLiteral("dummy.jpg"));
+
+    // Like the config dialog and a screen
+    auto model1 = new ImageProxyModel({m_dataDir.absolutePath()}, m_targetSize, this);
+    auto model2 = new ImageProxyModel({m_dataDir.absolutePath()}, m_targetSize, this);
+    waitForLoaded(model1);
+    waitForLoaded(model2);
+    QCOMPARE(model1->count(), 4);
+    QCOMPARE(model2->count(), 4);
+
+    // Additions and deletions only belong to the model
+    QCOMPARE(model1->addBackground(dummyWallpaperPath).size(), 1);
+    model1->removeBackground(wallpaperPath);
+    QCOMPARE(model1->count(), 4);
+    QVERIFY(model1->indexOf(dummyWallpaperPath) >= 0);
+    QCOMPARE(model1->indexOf(wallpaperPath), -1);
+
+    QCOMPARE(model2->count(), 4);
+    QCOMPARE(model2->indexOf(dummyWallpaperPath), -1);
+    QVERIFY(model2->indexOf(wallpaperPath) >= 0);
+    QVERIFY(QFile::exists(wallpaperPath));
+
+    // The removed wallpaper does not come back with the folder
+    QSignalSpy loadedSpy(model1->m_imageModel, &AbstractImageListModel::loaded);
+    model1->reload();
+    QVERIFY(loadedSpy.wait(10 * 1000));
+    QCOMPARE(model1->indexOf(wallpaperPath), -1);
+    QVERIFY(model1->indexOf(dummyWallpaperPath) >= 0);
+
+    delete model1;
+    delete model2;
+}
+
+void WallpaperCatalogTest::testWallpaperCatalogChangeRoots()
+{
+    WallpaperCatalog *catalog = WallpaperCatalog::self();
+
+    auto model = new ImageProxyModel({m_dataDir.absolutePath()}, m_targetSize, this);
+    waitForLoaded(model);
+    QCOMPARE(model->count(), 4);
+
+    QPointer<CatalogRoot> root = catalog->m_roots.value(m_dataDir.absolutePath()).root;
+    QVERIFY(root);
+
+    // Only the added folder is scanned
+    model->addRoots({m_alternateDir.absolutePath()});
+    QCOMPARE(catalog->count(), 2);
+    QVERIFY(!root->scanning());
+    QVERIFY(catalog->m_roots.value(m_alternateDir.absolutePath()).root->scanning());
+    QVERIFY(model->loading());
+
+    waitForLoaded(model);
+    QCOMPARE(model->count(), 7);
+
+    // Removing a folder scans nothing
+    model->removeRoots({m_alternateDir.absolutePath()});
+    QCOMPARE(catalog->count(), 1);
+    QVERIFY(!root->scanning());
+    QVERIFY(!model->loading());
+    QCOMPARE(model->count(), 4);
+
+    delete model;
+}
+
+void WallpaperCatalogTest::testWallpaperCatalogCoveredRoot()
+{
+    WallpaperCatalog *catalog = WallpaperCatalog::self();
+    const QString xmlDir = m_dataDir.absoluteFilePath(QStringLiteral("xml"));
+
+    auto model = new ImageProxyModel({xmlDir}, m_targetSize, this);
+    waitForLoaded(model);
+    QCOMPARE(model->count(), 2);
+
+    // The rows of the covered folder stay until the new parent is loaded
+    model->addRoots({m_dataDir.absolutePath()});
+    QVERIFY(model->loading());
+    QCOMPARE(model->count(), 2);
+    QCOMPARE(catalog->count(), 2);
+
+    waitForLoaded(model);
+    QCOMPARE(model->count(), 4);
+    QCOMPARE(catalog->count(), 1);
+
+    delete model;
+}
+
+QTEST_MAIN(WallpaperCatalogTest)
+
+#include "test_wallpapercatalog.moc"
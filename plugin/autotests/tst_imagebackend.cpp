@@ -33,6 +33,9 @@ TestSetup::TestSetup()
     // For target size test
     QCoreApplication::setAttribute(Qt::AA_DisableHighDpiScaling);
 
+    // The backend reads and writes the cache and config of the test user
+    QStandardPaths::setTestModeEnabled(true);
+
     m_dataDir = QDir(QFINDTESTDATA("testdata/default"));
 
     m_wallpaperPath = m_dataDir.absoluteFilePath(QStringLiteral("wallpaper.jpg.jpg"));
@@ -56,6 +56,19 @@ TestCase {
         }
     }
 
+    Component {
+        id: backendComponent
+
+        Wallpaper.ImageBackend {
+            property int modelImageChanges: 0
+
+            usedInConfig: false
+            renderingMode: Wallpaper.ImageBackend.SingleImage
+            targetSize: Qt.size(root.width, root.height)
+            onModelImageChanged: modelImageChanges++
+        }
+    }
+
     Window {
         id: window
         width: root.width
@@ -69,9 +82,10 @@ TestCase {
 
         verify(testImage.toString().length > 0);
         imageWallpaper.image = testImage;
-        compare(imageWallpaper.modelImage, testImage);
+        compare(imageWallpaper.modelImage.toString().indexOf("image://file/get?path="), 0);
 
         const image = createTemporaryObject(mainImage, window, {source: imageWallpaper.modelImage});
+        image.wait();
         compare(image.status, Image.Ready);
         const grabbed = grabImage(image);
         compare(grabbed.pixel(0, 0), Qt.rgba(0, 0, 0, 255));
@@ -106,6 +120,17 @@ TestCase {
         compare(modelImageChangedSignalSpy.count, 1);
     }
 
+    function test_showLastWallpaper() {
+        // Saves the wallpaper of this "session"
+        const backend1 = createTemporaryObject(backendComponent, root, {image: testImage});
+        verify(backend1.modelImage.toString().length > 0);
+
+        // The last wallpaper is shown once, not again when the image is loaded
+        const backend2 = createTemporaryObject(backendComponent, root, {image: testImage});
+        compare(backend2.modelImage.toString().indexOf("image://file/get?path="), 0);
+        compare(backend2.modelImageChanges, 1);
+    }
+
     function test_setXmlWallpaper() {
         imageWallpaper.renderingMode = Wallpaper.ImageBackend.SingleImage
 
@@ -0,0 +1,148 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "defaultwallpaperfinder.h"
+
+#include <mutex>
+
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QSet>
+#include <QStandardPaths>
+
+#include <KConfig>
+#include <KConfigGroup>
+
+#include "packagefinder.h"
+
+static QHash<QString, QUrl> s_defaults;
+static QSet<QUrl> s_brokenDefaults;
+static std::mutex s_defaultsMutex;
+
+static QString cacheKey(const QString &lookAndFeel, const QSize &targetSize)
+{
+    return QStringLiteral("%1@%2x%3").arg(lookAndFeel, QString::number(targetSize.width()), QString::number(targetSize.height()));
+}
+
+DefaultWallpaperFinder::DefaultWallpaperFinder(const QString &lookAndFeel, const QString &themeWallpaper, const QSize &targetSize, QObject *parent)
+    : QObject(parent)
+    , m_lookAndFeel(lookAndFeel)
+    , m_themeWallpaper(themeWallpaper)
+    , m_targetSize(targetSize)
+{
+}
+
+void DefaultWallpaperFinder::run()
+{
+    const QUrl url = findDefault();
+
+    {
+        std::lock_guard lock(s_defaultsMutex);
+        s_defaults.insert(cacheKey(m_lookAndFeel, m_targetSize), url);
+    }
+
+    Q_EMIT defaultFound(url);
+}
+
+bool DefaultWallpaperFinder::cachedDefault(const QString &lookAndFeel, const QSize &targetSize, QUrl &url)
+{
+    std::lock_guard lock(s_defaultsMutex);
+
+    const auto it = s_defaults.constFind(cacheKey(lookAndFeel, targetSize));
+
+    if (it == s_defaults.cend()) {
+        return false;
+    }
+
+    url = *it;
+    return true;
+}
+
+void DefaultWallpaperFinder::markBroken(const QUrl &url)
+{
+    std::lock_guard lock(s_defaultsMutex);
+
+    s_brokenDefaults.insert(url);
+
+    // The next lookup falls back to the next candidate
+    for (auto it = s_defaults.begin(); it != s_defaults.end();) {
+        if (*it == url) {
+            it = s_defaults.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool DefaultWallpaperFinder::isReadable(const QString &path)
+{
+    // Only reads the header, the image is not decoded
+    QImageReader reader(path);
+
+    return reader.canRead();
+}
+
+QUrl DefaultWallpaperFinder::findDefault() const
+{
+    // Try from the look and feel package first, then from the plasma theme
+    // If empty, it will be the default (currently Breeze)
+    const QString lookAndFeel = m_lookAndFeel.isEmpty() ? QStringLiteral("org.kde.breeze.desktop") : m_lookAndFeel;
+    const QString defaultsPath =
+        QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("plasma/look-and-feel/%1/contents/defaults").arg(lookAndFeel));
+
+    if (!defaultsPath.isEmpty()) {
+        const KConfig config(defaultsPath, KConfig::SimpleConfig);
+        const QString image = config.group("Wallpaper").readEntry("Image", QString());
+
+        if (!image.isEmpty()) {
+            const QString path = QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("wallpapers/") + image, QStandardPaths::LocateDirectory);
+
+            if (const QUrl url = checkWallpaper(path); !url.isEmpty()) {
+                return url;
+            }
+        }
+    }
+
+    // Try to get a default from the plasma theme
+    const int index = m_themeWallpaper.indexOf(QLatin1String("/contents/images/"));
+
+    if (index > -1) { // We have file from package -> get path to package
+        return checkWallpaper(m_themeWallpaper.left(index));
+    }
+
+    return checkWallpaper(m_themeWallpaper);
+}
+
+QUrl DefaultWallpaperFinder::checkWallpaper(const QString &path) const
+{
+    if (path.isEmpty()) {
+        return QUrl();
+    }
+
+    {
+        std::lock_guard lock(s_defaultsMutex);
+
+        if (s_brokenDefaults.contains(QUrl::fromLocalFile(path))) {
+            return QUrl();
+        }
+    }
+
+    const QFileInfo info(path);
+
+    if (info.isFile()) {
+        return isReadable(path) ? QUrl::fromLocalFile(path) : QUrl();
+    }
+
+    // Make sure the image can be read, or there will be dead loops.
+    const WallpaperPackage package = PackageFinder::parsePackage(path, m_targetSize);
+
+    if (package.path.isEmpty() || !isReadable(package.preferred)) {
+        return QUrl();
+    }
+
+    return QUrl::fromLocalFile(path);
+}
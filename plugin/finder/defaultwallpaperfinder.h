@@ -0,0 +1,67 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef DEFAULTWALLPAPERFINDER_H
+#define DEFAULTWALLPAPERFINDER_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QSize>
+#include <QUrl>
+
+/**
+ * A runnable that finds the default wallpaper of a Look and Feel package,
+ * falling back to the wallpaper of the Plasma theme.
+ *
+ * The image is only probed, not decoded, and the result is remembered for
+ * each Look and Feel package and target size. A default that passes the
+ * probe but fails to load is marked broken, so it is not applied again.
+ */
+class DefaultWallpaperFinder : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param lookAndFeel the Look and Feel package name, empty for the default one
+     * @param themeWallpaper the wallpaper path of the Plasma theme
+     */
+    DefaultWallpaperFinder(const QString &lookAndFeel, const QString &themeWallpaper, const QSize &targetSize, QObject *parent = nullptr);
+
+    void run() override;
+
+    /**
+     * @return @c true if the default wallpaper is known, and sets @p url
+     */
+    static bool cachedDefault(const QString &lookAndFeel, const QSize &targetSize, QUrl &url);
+
+    /**
+     * Forgets @p url and never finds it again, e.g. when the image passed
+     * the probe but could not be loaded
+     */
+    static void markBroken(const QUrl &url);
+
+    /**
+     * @return @c true if the image header can be read
+     */
+    static bool isReadable(const QString &path);
+
+Q_SIGNALS:
+    /**
+     * Emitted with an empty url when there is no usable default wallpaper
+     */
+    void defaultFound(const QUrl &url);
+
+private:
+    QUrl findDefault() const;
+    QUrl checkWallpaper(const QString &path) const;
+
+    QString m_lookAndFeel;
+    QString m_themeWallpaper;
+    QSize m_targetSize;
+};
+
+#endif // DEFAULTWALLPAPERFINDER_H
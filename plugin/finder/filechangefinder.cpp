@@ -0,0 +1,61 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "filechangefinder.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+
+#include "suffixcheck.h"
+
+FileChangeFinder::FileChangeFinder(const QStringList &created, const QStringList &deleted, const QSize &targetSize, QObject *parent)
+    : QObject(parent)
+    , m_created(created)
+    , m_deleted(deleted)
+    , m_targetSize(targetSize)
+{
+}
+
+void FileChangeFinder::run()
+{
+    WallpaperChanges changes;
+    changes.deleted = m_deleted;
+
+    QSet<QString> visited;
+
+    for (const QString &_path : std::as_const(m_created)) {
+        QString path = _path;
+
+        // A file in a package adds the package
+        if (int idx = path.indexOf(QLatin1String("contents/images/")); idx > 0) {
+            path = path.left(idx);
+        }
+
+        path = QDir::cleanPath(path);
+
+        if (visited.contains(path)) {
+            continue;
+        }
+        visited.insert(path);
+
+        const QFileInfo info(path);
+
+        if (info.isDir()) {
+            if (const WallpaperPackage package = PackageFinder::parsePackage(path, m_targetSize); !package.path.isEmpty()) {
+                changes.packages.append(package);
+            }
+        } else if (!info.isFile() || info.isHidden()) {
+            continue;
+        } else if (info.suffix().toLower() == QStringLiteral("xml")) {
+            changes.xmlItems += XmlFinder::parseXml(path, m_targetSize);
+        } else if (isAcceptableSuffix(info.suffix())) {
+            changes.images.append(path);
+        }
+    }
+
+    Q_EMIT changesFound(changes);
+}
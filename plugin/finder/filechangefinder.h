@@ -0,0 +1,51 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef FILECHANGEFINDER_H
+#define FILECHANGEFINDER_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QSize>
+#include <QStringList>
+
+#include "packagefinder.h"
+#include "xmlfinder.h"
+
+/**
+ * Validated wallpapers from a batch of file changes.
+ */
+struct WallpaperChanges {
+    QStringList images;
+    QList<WallpaperPackage> packages;
+    QList<WallpaperItem> xmlItems;
+    QStringList deleted;
+};
+Q_DECLARE_METATYPE(WallpaperChanges)
+
+/**
+ * A runnable that sorts created files into images, packages and XML
+ * wallpapers, so a burst of file changes is validated off the GUI thread.
+ */
+class FileChangeFinder : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    FileChangeFinder(const QStringList &created, const QStringList &deleted, const QSize &targetSize, QObject *parent = nullptr);
+
+    void run() override;
+
+Q_SIGNALS:
+    void changesFound(const WallpaperChanges &changes);
+
+private:
+    QStringList m_created;
+    QStringList m_deleted;
+    QSize m_targetSize;
+};
+
+#endif // FILECHANGEFINDER_H
@@ -8,9 +8,15 @@
 #include "packagefinder.h"
 
 #include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
+#include <KAboutData>
+#include <KConfig>
+#include <KConfigGroup>
 #include <KLocalizedString>
-#include <KPackage/PackageLoader>
+#include <KPluginMetaData>
 
 #include "distance.h"
 #include "findsymlinktarget.h"
@@ -25,15 +31,13 @@ PackageFinder::PackageFinder(const QStringList &paths, const QSize &targetSize,
 
 void PackageFinder::run()
 {
-    QList<KPackage::Package> packages;
+    QList<WallpaperPackage> packages;
     QStringList folders;
 
     QDir dir;
     dir.setFilter(QDir::Dirs | QDir::Readable);
 
-    KPackage::Package package = KPackage::PackageLoader::self()->loadPackage(QStringLiteral("Wallpaper/Images"));
-
-    const auto addPackage = [this, &package, &packages, &folders](const QString &_folderPath) {
+    const auto addPackage = [this, &packages, &folders](const QString &_folderPath) {
         const QString folderPath = _folderPath.endsWith(QDir::separator()) ? _folderPath : _folderPath + QDir::separator();
 
         if (folders.contains(folderPath)) {
@@ -41,32 +45,25 @@ void PackageFinder::run()
             return true;
         }
 
-        if (!QFile::exists(folderPath + QLatin1String("/metadata.desktop")) && !QFile::exists(folderPath + QLatin1String("/metadata.json"))) {
+        if (!QFile::exists(folderPath + QLatin1String("metadata.desktop")) && !QFile::exists(folderPath + QLatin1String("metadata.json"))) {
             return false;
         }
 
-        package.setPath(folderPath);
+        const WallpaperPackage package = parsePackage(folderPath, m_targetSize);
 
-        if (package.isValid() && package.metadata().isValid()) {
-            // Check if there are any available images.
-            QDir imageDir(package.filePath("images"));
-            imageDir.setFilter(QDir::Files | QDir::Readable);
-            imageDir.setNameFilters(suffixes());
+        if (!package.hasMetadata) {
+            // Broken metadata, search the subfolders instead
+            return false;
+        }
 
-            if (imageDir.entryInfoList().empty()) {
-                // This is an empty package. Skip it.
-                folders << folderPath;
-                return true;
-            }
+        // A package without available images is skipped, but its folder is not searched either.
+        folders << folderPath;
 
-            findPreferredImageInPackage(package, m_targetSize);
+        if (!package.path.isEmpty()) {
             packages << package;
-            folders << folderPath;
-
-            return true;
         }
 
-        return false; // Not found
+        return true;
     };
 
     int i;
@@ -104,56 +101,127 @@ void PackageFinder::run()
     Q_EMIT packageFound(packages);
 }
 
-void PackageFinder::findPreferredImageInPackage(KPackage::Package &package, const QSize &targetSize)
+WallpaperPackage PackageFinder::parsePackage(const QString &_folderPath, const QSize &targetSize)
 {
-    if (!package.isValid()) {
-        return;
+    WallpaperPackage package;
+    const QString folderPath = _folderPath.endsWith(QDir::separator()) ? _folderPath : _folderPath + QDir::separator();
+
+    if (const QString jsonPath = folderPath + QLatin1String("metadata.json"); QFile::exists(jsonPath)) {
+        QFile file(jsonPath);
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            return package;
+        }
+
+        const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+        if (root.isEmpty()) {
+            return package;
+        }
+
+        // Only used to resolve the translated name
+        const KPluginMetaData metadata(root, jsonPath);
+        package.name = metadata.name();
+
+        if (const auto authors = metadata.authors(); !authors.empty()) {
+            package.author = authors.at(0).name();
+        }
+    } else if (const QString desktopPath = folderPath + QLatin1String("metadata.desktop"); QFile::exists(desktopPath)) {
+        const KConfig config(desktopPath, KConfig::SimpleConfig);
+        const KConfigGroup group = config.group("Desktop Entry");
+
+        if (!group.exists()) {
+            return package;
+        }
+
+        package.name = group.readEntry("Name", QString());
+        package.author = group.readEntry("X-KDE-PluginInfo-Author", QString());
+    } else {
+        return package;
     }
 
-    QSize tSize = targetSize;
+    package.hasMetadata = true;
 
-    if (tSize.isEmpty()) {
-        tSize = QSize(1920, 1080);
+    // Check if there are any available images.
+    QDir imageDir(folderPath + QLatin1String("contents/images/"));
+    imageDir.setFilter(QDir::Files | QDir::Readable);
+    imageDir.setNameFilters(suffixes());
+
+    package.images = imageDir.entryList();
+
+    if (package.images.empty()) {
+        // This is an empty package. Skip it.
+        return package;
     }
 
-    // find preferred size
-    QString preferred;
-    {
-        const QStringList images = package.entryList("images");
+    package.imageDir = imageDir.absolutePath() + QDir::separator();
+    findPreferredImageInPackage(package, targetSize);
 
-        if (images.empty()) {
-            return;
-        }
+    if (package.name.isEmpty()) {
+        package.name = QFileInfo(package.preferred).completeBaseName();
+    }
+
+    package.path = folderPath;
 
-        float best = std::numeric_limits<float>::max();
+    return package;
+}
 
-        for (const QString &entry : images) {
-            QSize candidate = resSize(QFileInfo(entry).baseName());
+void PackageFinder::findPreferredImageInPackage(WallpaperPackage &package, const QSize &targetSize)
+{
+    QString preferred = findPreferredImage(package.images, targetSize);
 
-            if (candidate.isEmpty()) {
-                continue;
-            }
+    if (preferred.isEmpty() && !package.images.empty()) {
+        // No size information in the file names
+        preferred = package.images.at(0);
+    }
 
-            const float dist = distance(candidate, tSize);
+    package.preferred = preferred.isEmpty() ? QString() : package.imageDir + preferred;
+}
 
-            if (preferred.isEmpty() || dist < best) {
-                preferred = entry;
-                best = dist;
-            }
-        }
+void PackageFinder::findPreferredImageInPackage(KPackage::Package &package, const QSize &targetSize)
+{
+    if (!package.isValid()) {
+        return;
+    }
+
+    const QStringList images = package.entryList("images");
+
+    if (images.empty()) {
+        return;
     }
 
+    const QString preferred = findPreferredImage(images, targetSize);
+
     package.removeDefinition("preferred");
     package.addFileDefinition("preferred", QStringLiteral("images/") + preferred, i18n("Recommended wallpaper file"));
 }
 
-QString PackageFinder::packageDisplayName(const KPackage::Package &b)
+QString PackageFinder::findPreferredImage(const QStringList &images, const QSize &targetSize)
 {
-    const QString title = b.metadata().name();
+    QSize tSize = targetSize;
+
+    if (tSize.isEmpty()) {
+        tSize = QSize(1920, 1080);
+    }
 
-    if (title.isEmpty()) {
-        return QFileInfo(b.filePath("preferred")).completeBaseName();
+    // find preferred size
+    QString preferred;
+    float best = std::numeric_limits<float>::max();
+
+    for (const QString &entry : images) {
+        QSize candidate = resSize(QFileInfo(entry).baseName());
+
+        if (candidate.isEmpty()) {
+            continue;
+        }
+
+        const float dist = distance(candidate, tSize);
+
+        if (preferred.isEmpty() || dist < best) {
+            preferred = entry;
+            best = dist;
+        }
     }
 
-    return title;
+    return preferred;
 }
@@ -11,9 +11,25 @@
 #include <QObject>
 #include <QRunnable>
 #include <QSize>
+#include <QStringList>
 
 #include <KPackage/Package>
 
+/**
+ * A lightweight description of a KPackage wallpaper, read directly from
+ * metadata.json or metadata.desktop without loading a KPackage::Package.
+ */
+struct WallpaperPackage {
+    QString path; // Package folder, ends with a separator
+    QString name;
+    QString author;
+    QString imageDir; // contents/images/ in the package folder
+    QStringList images; // File names of the available variants in imageDir
+    QString preferred; // Absolute path of the variant matching the target size
+    bool hasMetadata = false; // The metadata could be read, even if there are no images
+};
+Q_DECLARE_METATYPE(WallpaperPackage)
+
 /**
  * A runnable that finds KPackage wallpapers.
  */
@@ -26,11 +42,20 @@ public:
 
     void run() override;
 
+    /**
+     * @return the package in @p folderPath, or a package with an empty path
+     *         if the folder is not a valid wallpaper package
+     */
+    static WallpaperPackage parsePackage(const QString &folderPath, const QSize &targetSize);
+    static void findPreferredImageInPackage(WallpaperPackage &package, const QSize &targetSize);
     static void findPreferredImageInPackage(KPackage::Package &package, const QSize &targetSize);
-    static QString packageDisplayName(const KPackage::Package &b);
+    /**
+     * @return the file name in @p images whose size is closest to @p targetSize
+     */
+    static QString findPreferredImage(const QStringList &images, const QSize &targetSize);
 
 Q_SIGNALS:
-    void packageFound(const QList<KPackage::Package> &packages);
+    void packageFound(const QList<WallpaperPackage> &packages);
 
 private:
     QStringList m_paths;
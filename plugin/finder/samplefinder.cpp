@@ -0,0 +1,269 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "samplefinder.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QRandomGenerator>
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+
+#include "findsymlinktarget.h"
+#include "packagefinder.h"
+#include "suffixcheck.h"
+#include "xmlfinder.h"
+
+namespace
+{
+// Gives up on a pick after this many walks, e.g. when most folders are empty
+constexpr int s_maxAttempts = 64;
+// Guards against very deep or looping folder structures
+constexpr int s_maxDepth = 64;
+// Forgets the least recently used folder weights when more folders than this are known
+constexpr int s_maxFolderWeights = 4096;
+
+struct FolderWeight {
+    int weight;
+    std::list<QString>::iterator recentIt;
+};
+
+// Estimated number of wallpapers below each folder, learnt from earlier walks
+QHash<QString, FolderWeight> s_folderWeights;
+// Most recently used folders first
+std::list<QString> s_recentFolders;
+qint64 s_folderWeightSum = 0;
+std::mutex s_folderWeightsMutex;
+
+bool isPackage(const QString &path)
+{
+    return QFile::exists(path + QLatin1String("/metadata.json")) || QFile::exists(path + QLatin1String("/metadata.desktop"));
+}
+
+/**
+ * @return the estimated weight of @p folder, or the average weight of the
+ *         known folders if it has not been listed yet
+ */
+int folderWeight(const QString &folder)
+{
+    std::lock_guard lock(s_folderWeightsMutex);
+
+    if (auto it = s_folderWeights.constFind(folder); it != s_folderWeights.cend()) {
+        s_recentFolders.splice(s_recentFolders.begin(), s_recentFolders, it->recentIt);
+        return it->weight;
+    }
+
+    if (s_folderWeights.empty()) {
+        return 1;
+    }
+
+    return std::max<int>(1, s_folderWeightSum / s_folderWeights.size());
+}
+
+void setFolderWeight(const QString &folder, int weight)
+{
+    std::lock_guard lock(s_folderWeightsMutex);
+
+    if (auto it = s_folderWeights.find(folder); it != s_folderWeights.end()) {
+        s_folderWeightSum += weight - it->weight;
+        it->weight = weight;
+        s_recentFolders.splice(s_recentFolders.begin(), s_recentFolders, it->recentIt);
+        return;
+    }
+
+    // Keeps the weights of the folders that are walked often
+    if (s_folderWeights.size() >= s_maxFolderWeights) {
+        s_folderWeightSum -= s_folderWeights.take(s_recentFolders.back()).weight;
+        s_recentFolders.pop_back();
+    }
+
+    s_recentFolders.push_front(folder);
+    s_folderWeights.insert(folder, {weight, s_recentFolders.begin()});
+    s_folderWeightSum += weight;
+}
+
+QString pickXmlWallpaper(const QString &path)
+{
+    const QList<WallpaperItem> items = XmlFinder::parseXml(path, QSize());
+
+    if (items.empty()) {
+        return QString();
+    }
+
+    return items.at(QRandomGenerator::global()->bounded(items.size())).path.toString();
+}
+}
+
+SampleFinder::SampleFinder(const QStringList &paths, const QStringList &history, const QStringList &excluded, QObject *parent)
+    : QObject(parent)
+    , m_paths(paths)
+    , m_history(history.cbegin(), history.cend())
+    , m_excluded(excluded.cbegin(), excluded.cend())
+{
+}
+
+void SampleFinder::run()
+{
+    QStringList roots;
+
+    for (const QString &path : std::as_const(m_paths)) {
+        if (QFileInfo(path).isDir()) {
+            roots.append(QDir::cleanPath(path));
+        }
+    }
+
+    QString fallback;
+
+    for (int i = 0; i < s_maxAttempts && !roots.empty(); i++) {
+        const QString path = walk(pickRoot(roots));
+
+        if (path.isEmpty() || m_excluded.contains(path)) {
+            continue;
+        }
+
+        if (!m_history.contains(path)) {
+            Q_EMIT sampleFound(path);
+            return;
+        }
+
+        if (fallback.isEmpty()) {
+            fallback = path;
+        }
+    }
+
+    // Repeating a recent wallpaper is better than showing nothing
+    Q_EMIT sampleFound(fallback);
+}
+
+QString SampleFinder::pickRoot(const QStringList &roots) const
+{
+    // Like the subfolders, a bigger root is more likely to be picked
+    QList<int> weights;
+    qint64 totalWeight = 0;
+
+    for (const QString &root : roots) {
+        weights.append(folderWeight(root));
+        totalWeight += weights.constLast();
+    }
+
+    qint64 pick = QRandomGenerator::global()->bounded(totalWeight);
+
+    for (int i = 0; i < roots.size(); i++) {
+        if (pick < weights.at(i)) {
+            return roots.at(i);
+        }
+
+        pick -= weights.at(i);
+    }
+
+    return roots.constLast();
+}
+
+QString SampleFinder::walk(const QString &root) const
+{
+    QStringList nameFilters = suffixes();
+    nameFilters.append(QStringLiteral("*.xml"));
+
+    QDir dir;
+    dir.setFilter(QDir::AllDirs | QDir::Files | QDir::Readable | QDir::NoDotAndDotDot);
+    dir.setNameFilters(nameFilters);
+    dir.setSorting(QDir::Unsorted);
+
+    QString current = root;
+    // Symlinked folders may point back up the tree
+    QSet<QString> visited{QFileInfo(root).canonicalFilePath()};
+
+    for (int depth = 0; depth < s_maxDepth; depth++) {
+        if (isPackage(current)) {
+            const WallpaperPackage package = PackageFinder::parsePackage(current, QSize());
+            return package.path;
+        }
+
+        dir.setPath(current);
+        const QFileInfoList entries = dir.entryInfoList();
+
+        QStringList candidates;
+        QStringList folders;
+        QList<int> weights;
+        int totalWeight = 0;
+
+        for (const QFileInfo &info : entries) {
+            if (info.fileName().startsWith(QLatin1Char('.'))) {
+                continue;
+            }
+
+            if (info.isFile()) {
+                // Like ImageFinder, symlinked images are skipped
+                if (!info.isSymLink() && info.baseName() != QLatin1String("screenshot")) {
+                    candidates.append(info.absoluteFilePath());
+                    totalWeight++;
+                }
+                continue;
+            }
+
+            // Symlinked folders are followed, unless the walk has been there
+            const QString path = findSymlinkTarget(info);
+
+            if (!info.isDir() || path.isEmpty() || (info.isSymLink() && visited.contains(info.canonicalFilePath()))) {
+                continue;
+            }
+
+            if (isPackage(path)) {
+                candidates.append(path);
+                totalWeight++;
+            } else {
+                // A bigger folder is more likely to be picked, so images in
+                // small folders are not shown too often. Listing every
+                // subfolder would defeat sampling, so the weights are the ones
+                // found by earlier walks.
+                const int weight = folderWeight(path);
+                folders.append(path);
+                weights.append(weight);
+                totalWeight += weight;
+            }
+        }
+
+        // Includes the estimates of the subfolders, so deep folders get their
+        // whole tree counted once the walks have been there
+        setFolderWeight(current, totalWeight);
+
+        if (totalWeight == 0) {
+            return QString();
+        }
+
+        int pick = QRandomGenerator::global()->bounded(totalWeight);
+
+        if (pick < candidates.size()) {
+            const QString path = candidates.at(pick);
+
+            if (QFileInfo(path).isDir()) {
+                return PackageFinder::parsePackage(path, QSize()).path;
+            } else if (path.endsWith(QLatin1String(".xml"), Qt::CaseInsensitive)) {
+                return pickXmlWallpaper(path);
+            }
+
+            return path;
+        }
+
+        pick -= candidates.size();
+
+        for (int i = 0; i < folders.size(); i++) {
+            if (pick < weights.at(i)) {
+                current = folders.at(i);
+                visited.insert(QFileInfo(current).canonicalFilePath());
+                break;
+            }
+
+            pick -= weights.at(i);
+        }
+    }
+
+    return QString();
+}
@@ -0,0 +1,62 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef SAMPLEFINDER_H
+#define SAMPLEFINDER_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QSet>
+#include <QStringList>
+
+/**
+ * A runnable that picks one random wallpaper in the specified paths without
+ * listing all of them.
+ *
+ * Each pick walks down from a random root. At every level, an image, a
+ * package or an XML wallpaper list counts as one entry, and a subfolder
+ * counts as many entries as earlier walks found below it. A pick costs one
+ * folder listing per level, and the memory used does not depend on the size
+ * of the library.
+ */
+class SampleFinder : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param history recently shown wallpapers, only picked when nothing else is found
+     * @param excluded wallpapers that are never picked
+     */
+    explicit SampleFinder(const QStringList &paths, const QStringList &history, const QStringList &excluded, QObject *parent = nullptr);
+
+    void run() override;
+
+Q_SIGNALS:
+    /**
+     * Emitted with an empty path when no wallpaper is found
+     */
+    void sampleFound(const QString &path);
+
+private:
+    /**
+     * @return one of @p roots, weighted like the folders of a walk
+     */
+    QString pickRoot(const QStringList &roots) const;
+    /**
+     * Walks down from @p root, following symlinked folders that have not
+     * been visited by the walk yet
+     *
+     * @return a random image or package, or an empty string at a dead end
+     */
+    QString walk(const QString &root) const;
+
+    QStringList m_paths;
+    QSet<QString> m_history;
+    QSet<QString> m_excluded;
+};
+
+#endif // SAMPLEFINDER_H
@@ -0,0 +1,45 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "sortkeyfinder.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+
+SortKeyFinder::SortKeyFinder(const QStringList &paths, QObject *parent)
+    : QObject(parent)
+    , m_paths(paths)
+{
+}
+
+void SortKeyFinder::run()
+{
+    QList<SlideSortKey> keys;
+    keys.reserve(m_paths.size());
+
+    for (const QString &path : std::as_const(m_paths)) {
+        keys.append(sortKey(path));
+    }
+
+    Q_EMIT sortKeysFound(keys);
+}
+
+SlideSortKey SortKeyFinder::sortKey(const QString &path)
+{
+    const QFileInfo info(path);
+    const QDateTime modified = info.lastModified();
+
+    SlideSortKey key;
+    key.path = path;
+    // Comparing case folded strings is the same as a case insensitive comparison
+    key.fileName = info.fileName().toCaseFolded();
+    key.folder = info.canonicalPath().append(QDir::separator()).toCaseFolded();
+    key.modified = modified.isValid() ? modified.toMSecsSinceEpoch() : 0;
+    key.valid = true;
+
+    return key;
+}
@@ -0,0 +1,49 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef SORTKEYFINDER_H
+#define SORTKEYFINDER_H
+
+#include <QList>
+#include <QObject>
+#include <QRunnable>
+#include <QStringList>
+
+/**
+ * File information used to sort slides, read once per slide.
+ */
+struct SlideSortKey {
+    QString path;
+    QString fileName; // Case folded
+    QString folder; // Case folded canonical folder, ends with a separator
+    qint64 modified = 0;
+    bool valid = false;
+};
+Q_DECLARE_METATYPE(QList<SlideSortKey>)
+
+/**
+ * A runnable that reads the sort keys of the specified files, so sorting
+ * slides does not stat every file in every comparison.
+ */
+class SortKeyFinder : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    explicit SortKeyFinder(const QStringList &paths, QObject *parent = nullptr);
+
+    void run() override;
+
+    static SlideSortKey sortKey(const QString &path);
+
+Q_SIGNALS:
+    void sortKeysFound(const QList<SlideSortKey> &keys);
+
+private:
+    QStringList m_paths;
+};
+
+#endif // SORTKEYFINDER_H
@@ -275,14 +275,18 @@ SlideshowData XmlFinder::parseSlideshowXml(const QString &path, const QSize &tar
                             } else if (xml.name() == QStringLiteral("file")) {
                                 const QStringList results = xml.readElementText(QXmlStreamReader::IncludeChildElements).simplified().split(QLatin1Char(' '));
 
-                                if (results.size() == 1) {
-                                    sdata.file = results.at(0);
-                                } else {
-                                    sdata.file = findPreferredImage(results, targetSize);
+                                for (const QString &file : results) {
+                                    if (QFileInfo(file).isRelative()) {
+                                        sdata.files.append(QFileInfo(path).absoluteDir().absoluteFilePath(file));
+                                    } else {
+                                        sdata.files.append(file);
+                                    }
                                 }
 
-                                if (QFileInfo(sdata.file).isRelative()) {
-                                    sdata.file = QFileInfo(path).absoluteDir().absoluteFilePath(sdata.file);
+                                if (sdata.files.size() == 1) {
+                                    sdata.file = sdata.files.at(0);
+                                } else {
+                                    sdata.file = findPreferredImage(sdata.files, targetSize);
                                 }
                             }
                         }
@@ -405,3 +409,12 @@ QString XmlFinder::findPreferredImage(const QStringList &pathList, const QSize &
 
     return preferred;
 }
+
+void XmlFinder::findPreferredImages(SlideshowData &data, const QSize &targetSize)
+{
+    for (SlideshowItemData &item : data.data) {
+        if (item.files.size() > 1) {
+            item.file = findPreferredImage(item.files, targetSize);
+        }
+    }
+}
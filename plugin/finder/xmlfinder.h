@@ -49,6 +49,7 @@ struct SlideshowItemData {
     quint64 duration; // unit: sec
 
     QString file;
+    QStringList files; // All the sizes of a static image, file is the one for the target size
 
     QString type;
     QString from;
@@ -118,6 +119,10 @@ public:
     static QStringList convertToPaths(const QUrl &url);
 
     static QString findPreferredImage(const QStringList &sizeList, const QSize &targetSize);
+    /**
+     * Picks the static images of @p data again for @p targetSize
+     */
+    static void findPreferredImages(SlideshowData &data, const QSize &targetSize);
 
 Q_SIGNALS:
     void xmlFound(const QList<WallpaperItem> &packages);
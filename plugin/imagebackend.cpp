@@ -12,39 +12,65 @@
 
 #include "imagebackend.h"
 
+#include <algorithm>
+#include <iterator>
 #include <math.h>
 
+#include <QCryptographicHash>
 #include <QDBusConnection>
 #include <QFileDialog>
 #include <QGuiApplication>
 #include <QImageReader>
 #include <QMimeDatabase>
 #include <QScreen>
+#include <QThreadPool>
 #include <QUrlQuery>
 
+#include <KConfigGroup>
 #include <KIO/CopyJob>
 #include <KIO/Job>
 #include <KIO/OpenUrlJob>
 #include <KLocalizedString>
 #include <KNotificationJobUiDelegate>
 #include <KPackage/PackageLoader>
+#include <KSharedConfig>
 #include <Plasma/Theme>
 
 #include "debug.h"
+#include "finder/defaultwallpaperfinder.h"
 #include "finder/packagefinder.h"
+#include "finder/samplefinder.h"
 #include "model/imageproxymodel.h"
+#include "provider/imagecache.h"
+#include "provider/xmlimageprovider.h"
 #include "slidefiltermodel.h"
 #include "slidemodel.h"
+#include "slideplaylist.h"
+#include "visibilitysource.h"
+
+static QString themeWallpaperPath()
+{
+    // Plasma::Theme lives on the GUI thread, and one instance follows theme changes for all backends
+    static Plasma::Theme *const s_theme = new Plasma::Theme(qGuiApp);
+
+    return s_theme->wallpaperPath();
+}
 
 ImageBackend::ImageBackend(QObject *parent)
     : QObject(parent)
     , m_targetSize(qGuiApp->primaryScreen()->size() * qGuiApp->primaryScreen()->devicePixelRatio())
     , m_slideFilterModel(new SlideFilterModel(this))
+    , m_playlist(new SlidePlaylist(m_slideFilterModel, this))
 {
-    connect(&m_timer, &QTimer::timeout, this, &ImageBackend::nextSlide);
+    connect(&m_scheduler, &SlideshowScheduler::timeout, this, &ImageBackend::nextSlide);
+    connect(&m_scheduler, &SlideshowScheduler::visibleChanged, this, &ImageBackend::slotVisibleChanged);
     connect(&m_xmlTimer, &QTimer::timeout, this, &ImageBackend::modelImageChanged);
+    connect(&m_xmlTimer, &XmlSlideshowUpdateTimer::prerenderRequested, this, [this](const QString &xmlpath, const QDateTime &time) {
+        // Same size as the image requested by QML
+        XmlImageProvider::prerender(xmlpath, m_targetSize, time, ImageCache::isCropFillMode(m_fillMode));
+    });
 
-    useSingleImageDefaults();
+    connect(this, &ImageBackend::modelImageChanged, this, &ImageBackend::saveLastWallpaper);
 }
 
 ImageBackend::~ImageBackend()
@@ -63,8 +89,23 @@ void ImageBackend::componentComplete()
     // to load the proper one afterwards etc etc
     m_ready = true;
 
+    if (!m_usedInConfig) {
+        // Pause the slideshow while the session is locked
+        m_scheduler.setVisibilitySource(new SessionVisibilitySource);
+    }
+
+    // Show the wallpaper of the last session before anything is scanned or loaded
+    const bool shown = showLastWallpaper();
+
     if (m_mode == SingleImage) {
-        setSingleImage();
+        if (!m_image.isEmpty()) {
+            setSingleImage();
+        } else if (shown) {
+            // Looking up the default wallpaper can wait for the first frame
+            QMetaObject::invokeMethod(this, &ImageBackend::useSingleImageDefaults, Qt::QueuedConnection);
+        } else {
+            useSingleImageDefaults();
+        }
     } else if (m_mode == SlideShow) {
         startSlideshow();
     }
@@ -82,6 +123,7 @@ void ImageBackend::setImage(const QUrl &url)
     }
 
     m_image = url;
+    m_configuredImage = url;
     Q_EMIT imageChanged();
 
     setSingleImage();
@@ -168,6 +210,8 @@ void ImageBackend::setTargetSize(const QSize &size)
     }
 
     m_targetSize = size;
+    // A package or an XML wallpaper may use another image now
+    m_restoredModelImage.clear();
 
     if (m_ready && (m_providerType == Provider::Package || m_providerType == Provider::Xml)) {
         Q_EMIT modelImageChanged();
@@ -179,55 +223,38 @@ void ImageBackend::setTargetSize(const QSize &size)
 
 void ImageBackend::useSingleImageDefaults()
 {
+    const QUrl failedImage = m_image;
     m_image.clear();
 
-    // Try from the look and feel package first, then from the plasma theme
-    KPackage::Package lookAndFeelPackage = KPackage::PackageLoader::self()->loadPackage(QStringLiteral("Plasma/LookAndFeel"));
     KConfigGroup cg(KSharedConfig::openConfig(QStringLiteral("kdeglobals")), "KDE");
     const QString packageName = cg.readEntry("LookAndFeelPackage", QString());
-    // If empty, it will be the default (currently Breeze)
-    if (!packageName.isEmpty()) {
-        lookAndFeelPackage.setPath(packageName);
-    }
-
-    KConfigGroup lnfDefaultsConfig = KConfigGroup(KSharedConfig::openConfig(lookAndFeelPackage.filePath("defaults")), "Wallpaper");
 
-    const QString image = lnfDefaultsConfig.readEntry("Image", "");
-    KPackage::Package package = KPackage::PackageLoader::self()->loadPackage(QStringLiteral("Wallpaper/Images"));
-
-    if (!image.isEmpty()) {
-        package.setPath(QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("wallpapers/") + image, QStandardPaths::LocateDirectory));
-
-        if (package.isValid()) {
-            m_image = QUrl::fromLocalFile(package.path());
-        }
-    }
-
-    // Try to get a default from the plasma theme
-    if (m_image.isEmpty()) {
-        Plasma::Theme theme;
-        QString path = theme.wallpaperPath();
-        int index = path.indexOf(QLatin1String("/contents/images/"));
-        if (index > -1) { // We have file from package -> get path to package
-            m_image = QUrl::fromLocalFile(path.left(index));
-        } else {
-            m_image = QUrl::fromLocalFile(path);
-        }
-
-        package.setPath(m_image.toLocalFile());
-
-        if (!package.isValid()) {
+    // Resolved once per session, later calls (e.g. on a broken image) are instant
+    if (QUrl url; DefaultWallpaperFinder::cachedDefault(packageName, m_targetSize, url)) {
+        if (url.isEmpty() || url != failedImage) {
+            slotDefaultWallpaperFound(url);
             return;
         }
+
+        // The default itself failed to load, e.g. a truncated image that
+        // passed the probe. Applying it again would loop forever.
+        DefaultWallpaperFinder::markBroken(url);
     }
 
-    PackageFinder::findPreferredImageInPackage(package, m_targetSize);
+    // Only the path of the theme wallpaper is passed on
+    auto finder = new DefaultWallpaperFinder(packageName, themeWallpaperPath(), m_targetSize);
+    connect(finder, &DefaultWallpaperFinder::defaultFound, this, &ImageBackend::slotDefaultWallpaperFound);
+    QThreadPool::globalInstance()->start(finder);
+}
 
-    // Make sure the image can be read, or there will be dead loops.
-    if (m_image.isEmpty() || QImage(package.filePath("preferred")).isNull()) {
+void ImageBackend::slotDefaultWallpaperFound(const QUrl &url)
+{
+    // An image may have been set in the meantime
+    if (url.isEmpty() || !m_image.isEmpty()) {
         return;
     }
 
+    m_image = url;
     Q_EMIT imageChanged();
     setSingleImage();
 }
@@ -235,6 +262,8 @@ void ImageBackend::useSingleImageDefaults()
 QAbstractItemModel *ImageBackend::wallpaperModel()
 {
     if (!m_model) {
+        // The folders are shared through WallpaperCatalog, the pending
+        // additions and deletions belong to this dialog
         m_model = new ImageProxyModel({}, m_targetSize, this);
         connect(this, &ImageBackend::targetSizeChanged, m_model, &ImageProxyModel::targetSizeChanged);
     }
@@ -425,9 +454,17 @@ void ImageBackend::setSingleImage()
     }
 
     switch (m_providerType) {
-    case Provider::Image:
-        m_modelImage = m_image;
+    case Provider::Image: {
+        // Use a custom image provider, so the decoded image is shared by all screens
+        QUrl url(QStringLiteral("image://file/get"));
+
+        QUrlQuery urlQuery(url);
+        urlQuery.addQueryItem(QStringLiteral("path"), m_image.toLocalFile());
+
+        url.setQuery(urlQuery);
+        m_modelImage = url;
         break;
+    }
 
     case Provider::Package: {
         // Use a custom image provider
@@ -451,7 +488,7 @@ void ImageBackend::setSingleImage()
     }
     }
 
-    if (!m_modelImage.isEmpty()) {
+    if (!m_modelImage.isEmpty() && !takeRestoredModelImage()) {
         Q_EMIT modelImageChanged();
     }
 }
@@ -461,8 +498,24 @@ void ImageBackend::startSlideshow()
     if (!m_ready || m_usedInConfig || m_mode != SlideShow) {
         return;
     }
+    m_scheduler.stop();
+
+    if (m_slideshowMode == SortingMode::Sampling) {
+        if (m_slideshowModel) {
+            disconnect(m_slideshowModel, &SlideModel::done, this, nullptr);
+        }
+
+        // Show the first slide right away instead of listing all slides
+        sampleNextSlide();
+        return;
+    }
+
+    if (!m_playbackRestored) {
+        // Shows the last slide while the folders are scanned
+        restorePlaybackState();
+    }
+
     // populate background list
-    m_timer.stop();
     slideshowModel()->setSlidePaths(m_slidePaths);
     connect(m_slideshowModel, &SlideModel::done, this, &ImageBackend::backgroundsFound);
     // TODO: what would be cool: paint on the wallpaper itself a busy widget and perhaps some text
@@ -477,17 +530,29 @@ void ImageBackend::backgroundsFound()
     m_slideFilterModel->setSourceModel(m_slideshowModel);
     m_slideFilterModel->invalidate();
 
+    if (m_slideFilterModel->sortKeysPending() && !m_usedInConfig) {
+        // File names and dates are read in the background
+        connect(m_slideFilterModel, &SlideFilterModel::sortKeysReady, this, &ImageBackend::slotSlidesSorted, Qt::UniqueConnection);
+        return;
+    }
+
+    slotSlidesSorted();
+}
+
+void ImageBackend::slotSlidesSorted()
+{
+    disconnect(m_slideFilterModel, &SlideFilterModel::sortKeysReady, this, nullptr);
+
     if (m_slideFilterModel->rowCount() == 0 || m_usedInConfig) {
         return;
     }
 
     // start slideshow
-    if (m_currentSlide == -1) {
-        m_currentSlide = m_slideFilterModel->indexOf(m_image.toString()) - 1;
-    } else {
-        m_currentSlide = -1;
-    }
     m_slideFilterModel->sort(0);
+    m_playlist->setShuffled(m_slideshowMode == SortingMode::Random);
+    // Continue with the current image the first time
+    m_playlist->reset(m_slideshowStarted ? QString() : m_image.toString());
+    m_slideshowStarted = !m_slideshowStarted;
     nextSlide();
 }
 
@@ -576,6 +641,15 @@ void ImageBackend::slotUpdateXmlModelImage(const QPalette &palette)
     }
 
     m_modelImage = url;
+
+    if (takeRestoredModelImage()) {
+        // Only (re)start the timer, the image is already shown
+        if (m_xmlTimer.isEnabled()) {
+            m_xmlTimer.alignInterval();
+        }
+        return;
+    }
+
     Q_EMIT modelImageChanged();
 }
 
@@ -583,22 +657,45 @@ void ImageBackend::slotPrepareForSleep(bool sleep)
 {
     if (!sleep) {
         // Resume from sleep
+        slotXmlFrameOutdated();
+    }
+}
+
+void ImageBackend::slotXmlFrameOutdated()
+{
+    // A hidden wallpaper catches up in slotVisibleChanged
+    if (m_scheduler.isVisible()) {
+        Q_EMIT modelImageChanged();
+    }
+}
+
+void ImageBackend::slotVisibleChanged(bool visible)
+{
+    if (!m_xmlTimer.isEnabled()) {
+        return;
+    }
+
+    m_xmlTimer.setPaused(!visible);
+
+    if (visible) {
+        // Skip the frames that were missed, show the one for now. Will restart the timer.
         Q_EMIT modelImageChanged();
     }
 }
 
 void ImageBackend::toggleXmlSlideshow(bool enabled)
 {
-    if (enabled == m_xmlTimer.isActive()) {
+    if (enabled == m_xmlTimer.isEnabled()) {
         return;
     }
 
+    m_xmlTimer.setPaused(!m_scheduler.isVisible());
     m_xmlTimer.setActive(enabled);
 
     if (enabled) {
         // Will start/restart the timer
         m_changeConnection = connect(this, &ImageBackend::modelImageChanged, &m_xmlTimer, &XmlSlideshowUpdateTimer::alignInterval);
-        m_clockSkewdConnection = connect(&m_xmlTimer, &XmlSlideshowUpdateTimer::clockSkewed, this, &ImageBackend::modelImageChanged);
+        m_clockSkewdConnection = connect(&m_xmlTimer, &XmlSlideshowUpdateTimer::clockSkewed, this, &ImageBackend::slotXmlFrameOutdated);
 
         // Refresh slideshow after resume from sleep
         // clang-format off
@@ -649,40 +746,224 @@ QString ImageBackend::addUsersWallpaper(const QString &file)
 
 void ImageBackend::nextSlide()
 {
-    const int rowCount = m_slideFilterModel->rowCount();
+    if (m_slideshowMode == SortingMode::Sampling) {
+        if (m_ready && !m_usedInConfig && m_mode == SlideShow) {
+            sampleNextSlide();
+        }
+        return;
+    }
 
-    if (!m_ready || m_usedInConfig || rowCount == 0) {
+    if (!m_ready || m_usedInConfig) {
         return;
     }
-    int previousSlide = m_currentSlide;
-    QString previousPath;
-    if (previousSlide >= 0) {
-        previousPath = m_slideFilterModel->index(m_currentSlide, 0).data(ImageRoles::PackageNameRole).toString();
+
+    // The playlist reshuffles itself at the end of a cycle, SlideFilterModel is left alone
+    const QString next = m_playlist->next();
+
+    if (next.isEmpty()) {
+        return;
     }
-    if (m_currentSlide == rowCount - 1 || m_currentSlide < 0) {
-        m_currentSlide = 0;
-    } else {
-        m_currentSlide += 1;
+
+    m_scheduler.stop();
+    m_scheduler.start(m_delay * 1000);
+
+    m_image = QUrl(next);
+    Q_EMIT imageChanged();
+    setSingleImage();
+    savePlaybackState();
+    prefetchUpcomingSlides();
+}
+
+void ImageBackend::prefetchUpcomingSlides()
+{
+    // Will be done by the slide shown when the wallpaper can be seen again
+    if (!m_scheduler.isVisible()) {
+        return;
     }
-    // We are starting again - avoid having the same random order when we restart the slideshow
-    if (m_slideshowMode == SortingMode::Random && m_currentSlide == 0) {
-        m_slideFilterModel->invalidate();
+
+    QStringList paths;
+    const QStringList upcoming = m_playlist->upcoming(2);
+
+    // XML wallpapers depend on the time of day, only images and packages are decoded ahead
+    std::copy_if(upcoming.cbegin(), upcoming.cend(), std::back_inserter(paths), [](const QString &path) {
+        return !path.startsWith(QLatin1String("image://"));
+    });
+
+    ImageCache::self()->prefetch(paths, m_targetSize, ImageCache::isCropFillMode(m_fillMode));
+}
+
+KConfigGroup ImageBackend::lastWallpaperGroup() const
+{
+    // One record for each configured image or set of slide folders
+    QStringList paths = m_slidePaths;
+    paths.sort();
+
+    const QString id = m_mode == SingleImage ? m_configuredImage.toString() : paths.join(QLatin1Char('\n'));
+    const QByteArray hash = QCryptographicHash::hash(QByteArray::number(m_mode) + id.toUtf8(), QCryptographicHash::Md5).toHex();
+
+    return KConfigGroup(KSharedConfig::openStateConfig(), QStringLiteral("LastWallpaper")).group(QString::fromLatin1(hash));
+}
+
+bool ImageBackend::showLastWallpaper()
+{
+    if (m_usedInConfig) {
+        return false;
     }
-    QString next = m_slideFilterModel->index(m_currentSlide, 0).data(ImageRoles::PackageNameRole).toString();
-    // And  avoid showing the same picture twice
-    if (previousSlide == rowCount - 1 && previousPath == next && rowCount > 1) {
-        m_currentSlide += 1;
-        next = m_slideFilterModel->index(m_currentSlide, 0).data(ImageRoles::PackageNameRole).toString();
+
+    const KConfigGroup cg = lastWallpaperGroup();
+    const QUrl modelImage(cg.readEntry("ModelImage", QString()));
+    const auto provider = static_cast<Provider>(cg.readEntry("Provider", static_cast<int>(Provider::Image)));
+
+    if (modelImage.isEmpty()) {
+        return false;
     }
-    m_timer.stop();
-    m_timer.start(m_delay * 1000);
-    if (next.isEmpty()) {
-        m_image = QUrl(previousPath); // setSingleImage will add "file://"
-    } else {
-        m_image = QUrl(next);
-        Q_EMIT imageChanged();
-        setSingleImage();
+
+    // A package or an XML wallpaper may have a better image for another size
+    if (provider != Provider::Image && cg.readEntry("TargetSize", QSize()) != m_targetSize) {
+        return false;
+    }
+
+    // Make sure the record is still valid, or the defaults would be used
+    QString path;
+
+    switch (provider) {
+    case Provider::Image:
+        path = modelImage.isLocalFile() ? modelImage.toLocalFile() : QUrlQuery(modelImage).queryItemValue(QStringLiteral("path"));
+        break;
+    case Provider::Package:
+        path = QUrlQuery(modelImage).queryItemValue(QStringLiteral("dir"));
+        break;
+    case Provider::Xml:
+        path = QUrlQuery(modelImage).queryItemValue(QStringLiteral("filename"));
+        break;
+    }
+
+    if (path.isEmpty() || !QFileInfo::exists(path)) {
+        return false;
+    }
+
+    m_providerType = provider;
+    m_modelImage = modelImage;
+    m_restoredModelImage = modelImage;
+
+    // Nothing new to save
+    m_savedLastWallpaper = {cg.name(), modelImage, m_targetSize};
+
+    Q_EMIT modelImageChanged();
+
+    return true;
+}
+
+bool ImageBackend::takeRestoredModelImage()
+{
+    const bool restored = !m_restoredModelImage.isEmpty() && m_restoredModelImage == m_modelImage;
+    m_restoredModelImage.clear();
+
+    return restored;
+}
+
+void ImageBackend::saveLastWallpaper()
+{
+    if (!m_ready || m_usedInConfig || m_modelImage.isEmpty()) {
+        return;
+    }
+
+    // For an XML wallpaper the frame is resolved again from the url when the image is loaded,
+    // so frame changes, resumes and the like are not written
+    KConfigGroup cg = lastWallpaperGroup();
+    const SavedWallpaper saved{cg.name(), m_modelImage, m_targetSize};
+
+    if (saved == m_savedLastWallpaper) {
+        return;
+    }
+
+    m_savedLastWallpaper = saved;
+    cg.writeEntry("ModelImage", m_modelImage.toString());
+    cg.writeEntry("Provider", static_cast<int>(m_providerType));
+    cg.writeEntry("TargetSize", m_targetSize);
+}
+
+KConfigGroup ImageBackend::playbackStateGroup() const
+{
+    // One state for each set of folders and order
+    QStringList paths = m_slidePaths;
+    paths.sort();
+    paths.append(QString::number(m_slideshowMode));
+
+    const QByteArray id = QCryptographicHash::hash(paths.join(QLatin1Char('\n')).toUtf8(), QCryptographicHash::Md5).toHex();
+
+    return KConfigGroup(KSharedConfig::openStateConfig(), QStringLiteral("SlideshowPlayback")).group(QString::fromLatin1(id));
+}
+
+void ImageBackend::restorePlaybackState()
+{
+    m_playbackRestored = true;
+
+    const KConfigGroup cg = playbackStateGroup();
+    const QString current = cg.readEntry("Current", QString());
+
+    if (current.isEmpty() || (!current.startsWith(QLatin1String("image://")) && !QFileInfo::exists(current))) {
+        return;
+    }
+
+    if (m_slideshowMode == SortingMode::Random) {
+        m_playlist->restore(cg.readEntry("Upcoming", QStringList{}));
+    }
+
+    m_image = QUrl(current);
+    Q_EMIT imageChanged();
+    setSingleImage();
+
+    m_scheduler.start(m_delay * 1000);
+}
+
+void ImageBackend::savePlaybackState()
+{
+    // Only the next slides are saved, so the state stays small in large folders
+    const QStringList upcoming = m_slideshowMode == SortingMode::Random ? m_playlist->upcoming(100) : QStringList();
+
+    KConfigGroup cg = playbackStateGroup();
+    cg.writeEntry("Current", m_image.toString());
+    cg.writeEntry("Upcoming", upcoming);
+}
+
+void ImageBackend::sampleNextSlide()
+{
+    QStringList history = m_sampleHistory;
+
+    if (!m_image.isEmpty()) {
+        history.append(m_image.toString());
+    }
+
+    auto finder = new SampleFinder(m_slidePaths, history, m_uncheckedSlides);
+    connect(finder, &SampleFinder::sampleFound, this, &ImageBackend::slotSampleFound);
+    QThreadPool::globalInstance()->start(finder);
+}
+
+void ImageBackend::slotSampleFound(const QString &path)
+{
+    // The slideshow may have been changed while the finder was running
+    if (!m_ready || m_usedInConfig || m_mode != SlideShow || m_slideshowMode != SortingMode::Sampling) {
+        return;
+    }
+
+    m_scheduler.stop();
+    m_scheduler.start(m_delay * 1000);
+
+    if (path.isEmpty()) {
+        return;
     }
+
+    m_sampleHistory.append(path);
+
+    // Enough to avoid repeats in a small folder, and constant in a large one
+    while (m_sampleHistory.size() > 16) {
+        m_sampleHistory.removeFirst();
+    }
+
+    m_image = QUrl(path);
+    Q_EMIT imageChanged();
+    setSingleImage();
 }
 
 void ImageBackend::slotSlideModelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
@@ -755,6 +1036,55 @@ void ImageBackend::openModelImage() const
     job->start();
 }
 
+bool ImageBackend::outputVisible() const
+{
+    return m_outputVisible;
+}
+
+void ImageBackend::setOutputVisible(bool visible)
+{
+    if (visible == m_outputVisible) {
+        return;
+    }
+
+    m_outputVisible = visible;
+    m_scheduler.setOutputVisible(visible);
+
+    Q_EMIT outputVisibleChanged();
+}
+
+int ImageBackend::prerenderLeadTime() const
+{
+    return m_xmlTimer.prerenderLeadTime();
+}
+
+void ImageBackend::setPrerenderLeadTime(int msec)
+{
+    if (msec == m_xmlTimer.prerenderLeadTime()) {
+        return;
+    }
+
+    m_xmlTimer.setPrerenderLeadTime(msec);
+
+    Q_EMIT prerenderLeadTimeChanged();
+}
+
+int ImageBackend::fillMode() const
+{
+    return m_fillMode;
+}
+
+void ImageBackend::setFillMode(int fillMode)
+{
+    if (fillMode == m_fillMode) {
+        return;
+    }
+
+    m_fillMode = fillMode;
+
+    Q_EMIT fillModeChanged();
+}
+
 QStringList ImageBackend::uncheckedSlides() const
 {
     return m_uncheckedSlides;
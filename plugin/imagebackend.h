@@ -17,6 +17,7 @@
 
 #include <KPackage/Package>
 
+#include "slideshowscheduler.h"
 #include "sortingmode.h"
 #include "xmlslideshowupdatetimer.h"
 
@@ -24,11 +25,13 @@ class QFileDialog;
 class QPalette;
 class QQuickItem;
 
+class KConfigGroup;
 class KDirWatch;
 class KJob;
 class ImageProxyModel;
 class SlideModel;
 class SlideFilterModel;
+class SlidePlaylist;
 
 class ImageBackend : public QObject, public QQmlParserStatus, public SortingMode
 {
@@ -46,7 +49,7 @@ class ImageBackend : public QObject, public QQmlParserStatus, public SortingMode
     Q_PROPERTY(QUrl image READ image WRITE setImage NOTIFY imageChanged)
     /**
      * The real path of the image
-     * e.g. /home/kde/Pictures/image.png
+     * e.g. image://file/get?path=/home/kde/Pictures/image.png
      *      image://package/get? (KPackage)
      */
     Q_PROPERTY(QUrl modelImage READ modelImage NOTIFY modelImageChanged)
@@ -62,6 +65,21 @@ class ImageBackend : public QObject, public QQmlParserStatus, public SortingMode
     Q_PROPERTY(QStringList slidePaths READ slidePaths WRITE setSlidePaths NOTIFY slidePathsChanged)
     Q_PROPERTY(QSize targetSize READ targetSize WRITE setTargetSize NOTIFY targetSizeChanged)
     Q_PROPERTY(QStringList uncheckedSlides READ uncheckedSlides WRITE setUncheckedSlides NOTIFY uncheckedSlidesChanged)
+    /**
+     * Whether the window of the wallpaper is shown. The slideshow pauses
+     * while it is hidden or the session is locked.
+     */
+    Q_PROPERTY(bool outputVisible READ outputVisible WRITE setOutputVisible NOTIFY outputVisibleChanged)
+    /**
+     * How long before the next frame of an XML slideshow it is rendered in
+     * the background, in milliseconds. 0 disables pre-rendering.
+     */
+    Q_PROPERTY(int prerenderLeadTime READ prerenderLeadTime WRITE setPrerenderLeadTime NOTIFY prerenderLeadTimeChanged)
+    /**
+     * The fill mode of the wallpaper image, so images decoded ahead only
+     * keep the part that is shown
+     */
+    Q_PROPERTY(int fillMode READ fillMode WRITE setFillMode NOTIFY fillModeChanged)
 
 public:
     enum RenderingMode {
@@ -126,6 +144,15 @@ public:
     QStringList uncheckedSlides() const;
     void setUncheckedSlides(const QStringList &uncheckedSlides);
 
+    bool outputVisible() const;
+    void setOutputVisible(bool visible);
+
+    int prerenderLeadTime() const;
+    void setPrerenderLeadTime(int msec);
+
+    int fillMode() const;
+    void setFillMode(int fillMode);
+
 public Q_SLOTS:
     void nextSlide();
     void slotSlideModelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
@@ -145,15 +172,24 @@ Q_SIGNALS:
     void customWallpaperPicked(const QString &path);
     void uncheckedSlidesChanged();
     void isTransitionChanged();
+    void outputVisibleChanged();
+    void prerenderLeadTimeChanged();
+    void fillModeChanged();
 
 protected Q_SLOTS:
     void showAddSlidePathsDialog();
     void slotWallpaperBrowseCompleted();
     void slotUpdateXmlModelImage(const QPalette &palette);
     void slotPrepareForSleep(bool sleep);
+    void slotXmlFrameOutdated();
     void startSlideshow();
     void addDirFromSelectionDialog();
     void backgroundsFound();
+    void slotSlidesSorted();
+    void saveLastWallpaper();
+    void slotSampleFound(const QString &path);
+    void slotDefaultWallpaperFound(const QUrl &url);
+    void slotVisibleChanged(bool visible);
 
 protected:
     void setSingleImage();
@@ -163,12 +199,57 @@ private:
 
     void toggleXmlSlideshow(bool enabled);
 
+    /**
+     * Shows what was shown in the last session, if the record is still valid
+     *
+     * @return @c true if the wallpaper was shown
+     */
+    bool showLastWallpaper();
+    KConfigGroup lastWallpaperGroup() const;
+
+    /**
+     * @return @c true once if the model image is the one shown by
+     *         showLastWallpaper(), so it is not emitted again
+     */
+    bool takeRestoredModelImage();
+
+    /**
+     * Shows the slide of the last session and restores its play order
+     */
+    void restorePlaybackState();
+    void savePlaybackState();
+    KConfigGroup playbackStateGroup() const;
+
+    /**
+     * Decodes the next slides in the background, so they are shown at once
+     */
+    void prefetchUpcomingSlides();
+
+    /**
+     * Picks the next slide in the background in sampling mode
+     */
+    void sampleNextSlide();
+
     bool m_ready = false;
     int m_delay = 10;
     QUrl m_image;
+    QUrl m_configuredImage; // The image from the configuration, not the default
     QUrl m_modelImage;
     QSize m_targetSize;
 
+    struct SavedWallpaper {
+        QString group;
+        QUrl modelImage;
+        QSize targetSize;
+
+        bool operator==(const SavedWallpaper &other) const
+        {
+            return group == other.group && modelImage == other.modelImage && targetSize == other.targetSize;
+        }
+    };
+    SavedWallpaper m_savedLastWallpaper; // What saveLastWallpaper() wrote last
+    QUrl m_restoredModelImage; // Shown by showLastWallpaper() and not emitted again yet
+
     bool m_usedInConfig = true;
 
     RenderingMode m_mode = SingleImage;
@@ -179,12 +260,17 @@ private:
     KPackage::Package m_wallpaperPackage;
     QStringList m_slidePaths;
     QStringList m_uncheckedSlides;
-    QTimer m_timer;
+    SlideshowScheduler m_scheduler;
+    bool m_outputVisible = true;
+    int m_fillMode = 2; // Image.PreserveAspectCrop
     XmlSlideshowUpdateTimer m_xmlTimer;
-    int m_currentSlide = -1;
+    bool m_slideshowStarted = false;
+    bool m_playbackRestored = false;
+    QStringList m_sampleHistory; // Recently shown slides in sampling mode
     ImageProxyModel *m_model = nullptr;
     SlideModel *m_slideshowModel = nullptr;
     SlideFilterModel *m_slideFilterModel;
+    SlidePlaylist *m_playlist;
     QFileDialog *m_dialog = nullptr;
 
     QMetaObject::Connection m_changeConnection;
@@ -11,6 +11,7 @@
 
 #include "imagebackend.h"
 #include "finder/xmlfinder.h"
+#include "provider/fileimageprovider.h"
 #include "provider/packageimageprovider.h"
 #include "provider/xmlimageprovider.h"
 #include "sortingmode.h"
@@ -23,6 +24,7 @@ void ImagePlugin::initializeEngine(QQmlEngine *engine, const char *uri)
 
     engine->addImageProvider(QStringLiteral("package"), new PackageImageProvider);
     engine->addImageProvider(QStringLiteral("gnome-wp-list"), new XmlImageProvider);
+    engine->addImageProvider(QStringLiteral("file"), new FileImageProvider);
 }
 
 void ImagePlugin::registerTypes(const char *uri)
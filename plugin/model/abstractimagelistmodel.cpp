@@ -6,13 +6,19 @@
 
 #include "abstractimagelistmodel.h"
 
+#include <QDir>
 #include <QPixmap>
 #include <QThreadPool>
+#include <QUrl>
 
 #include <KFileItem>
 #include <KIO/PreviewJob>
 
+#include "../finder/filechangefinder.h"
 #include "../finder/imagesizefinder.h"
+#include "catalogroot.h"
+#include "imageproxymodel.h"
+#include "wallpapercatalog.h"
 
 AbstractImageListModel::AbstractImageListModel(const QSize &targetSize, QObject *parent)
     : QAbstractListModel(parent)
@@ -22,9 +28,33 @@ AbstractImageListModel::AbstractImageListModel(const QSize &targetSize, QObject
     m_imageCache.setMaxCost(m_screenshotSize.width() * m_screenshotSize.height() * 20);
     m_imageSizeCache.setMaxCost(20);
 
-    connect(this, &QAbstractListModel::rowsInserted, this, &AbstractImageListModel::countChanged);
-    connect(this, &QAbstractListModel::rowsRemoved, this, &AbstractImageListModel::countChanged);
+    // A diff reload reports the new count only once
+    const auto notifyCountChanged = [this] {
+        if (!m_applyingDiff) {
+            Q_EMIT countChanged();
+        }
+    };
+
+    connect(this, &QAbstractListModel::rowsInserted, this, notifyCountChanged);
+    connect(this, &QAbstractListModel::rowsRemoved, this, notifyCountChanged);
     connect(this, &QAbstractListModel::modelReset, this, &AbstractImageListModel::countChanged);
+
+    connect(WallpaperCatalog::self(), &WallpaperCatalog::changesFound, this, &AbstractImageListModel::slotCatalogChangesFound);
+}
+
+AbstractImageListModel::~AbstractImageListModel()
+{
+    const auto roots = m_roots;
+
+    for (CatalogRoot *root : roots) {
+        releaseRoot(root);
+    }
+
+    DirectoryWatcher *dirWatch = WallpaperCatalog::self()->directoryWatcher();
+
+    for (const QString &path : std::as_const(m_watchedWallpapers)) {
+        dirWatch->removePath(path);
+    }
 }
 
 QHash<int, QByteArray> AbstractImageListModel::roleNames() const
@@ -47,19 +77,226 @@ int AbstractImageListModel::count() const
     return rowCount();
 }
 
+void AbstractImageListModel::load(const QStringList &customPaths)
+{
+    if (m_loading || customPaths.empty()) {
+        return;
+    }
+
+    // Acquire the new folders first, so the ones kept are not scanned again
+    const QList<CatalogRoot *> oldRoots = m_roots;
+    m_roots.clear();
+    m_retiredRoots.clear();
+
+    acquireRoots(customPaths);
+
+    for (CatalogRoot *root : oldRoots) {
+        if (!m_roots.contains(root)) {
+            disconnect(root, nullptr, this, nullptr);
+        }
+
+        WallpaperCatalog::self()->release(root);
+    }
+
+    m_loading = true;
+    m_scanning = false;
+
+    // The folders may be loaded already, but the rows still show up after load()
+    QMetaObject::invokeMethod(this, &AbstractImageListModel::slotRootChanged, Qt::QueuedConnection);
+}
+
 void AbstractImageListModel::reload()
 {
-    if (m_loading || m_customPaths.empty()) {
+    if (m_loading || m_roots.empty()) {
+        return;
+    }
+
+    m_loading = true;
+
+    for (CatalogRoot *root : std::as_const(m_roots)) {
+        root->scan();
+    }
+}
+
+void AbstractImageListModel::addRoots(const QStringList &roots)
+{
+    if (roots.empty()) {
+        return;
+    }
+
+    acquireRoots(roots);
+
+    // The rows of a loading model show up when all its folders are loaded
+    if (m_loading) {
+        return;
+    }
+
+    m_scanning = rootsScanning();
+    mergeRoots();
+}
+
+void AbstractImageListModel::removeRoots(const QStringList &roots)
+{
+    for (const QString &path : roots) {
+        const QString normalizedPath = ImageProxyModel::normalizedRoot(path);
+
+        const auto it = std::find_if(m_roots.cbegin(), m_roots.cend(), [&normalizedPath](const CatalogRoot *root) {
+            return root->path() == normalizedPath;
+        });
+
+        if (it == m_roots.cend()) {
+            continue;
+        }
+
+        // Keep the rows until the covering root has scanned them, so they do not disappear for a while
+        if (!isCoveredByScanningRoot(*it)) {
+            releaseRoot(*it);
+        } else if (!m_retiredRoots.contains(*it)) {
+            m_retiredRoots.append(*it);
+        }
+    }
+
+    if (m_loading) {
         return;
     }
 
-    load(m_customPaths);
+    mergeRoots();
+
+    if (m_scanning && !rootsScanning()) {
+        m_scanning = false;
+        Q_EMIT rootsScanned(this);
+    }
+}
+
+bool AbstractImageListModel::scanning() const
+{
+    return m_scanning;
+}
+
+bool AbstractImageListModel::isInRoots(const QString &_path, const QStringList &roots)
+{
+    const QString path = QDir::cleanPath(_path);
+
+    return std::any_of(roots.cbegin(), roots.cend(), [&path](const QString &_root) {
+        const QString root = QDir::cleanPath(_root);
+        return path == root || path.startsWith(root + QLatin1Char('/'));
+    });
 }
 
 void AbstractImageListModel::slotTargetSizeChanged(const QSize &size)
 {
     m_targetSize = size;
-    reload();
+
+    if (!m_loading) {
+        mergeRoots();
+    }
+}
+
+void AbstractImageListModel::watchAddedWallpaper(const QString &packageName)
+{
+    const QStringList paths = WallpaperCatalog::watchedPaths(packageName);
+    DirectoryWatcher *dirWatch = WallpaperCatalog::self()->directoryWatcher();
+
+    for (const QString &path : paths) {
+        dirWatch->addPath(path);
+    }
+
+    m_watchedWallpapers.append(packageName);
+}
+
+void AbstractImageListModel::markRemoved(const QString &packageName)
+{
+    m_removed.insert(packageName);
+
+    if (!m_watchedWallpapers.removeOne(packageName)) {
+        return;
+    }
+
+    const QStringList paths = WallpaperCatalog::watchedPaths(packageName);
+    DirectoryWatcher *dirWatch = WallpaperCatalog::self()->directoryWatcher();
+
+    for (const QString &path : paths) {
+        dirWatch->removePath(path);
+    }
+}
+
+void AbstractImageListModel::slotRootChanged()
+{
+    releaseRetiredRoots();
+
+    // All the folders show up at once when loading
+    if (m_loading && rootsScanning()) {
+        return;
+    }
+
+    mergeRoots();
+
+    if (m_loading) {
+        m_loading = false;
+        Q_EMIT loaded(this);
+    } else if (m_scanning && !rootsScanning()) {
+        m_scanning = false;
+        Q_EMIT rootsScanned(this);
+    }
+}
+
+void AbstractImageListModel::slotCatalogChangesFound(const WallpaperChanges &changes)
+{
+    // The folders are already updated, only the added wallpapers are left
+    if (!m_watchedWallpapers.empty() && !changes.deleted.empty()) {
+        removeBackgrounds(changes.deleted);
+    }
+}
+
+void AbstractImageListModel::acquireRoots(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        CatalogRoot *root = WallpaperCatalog::self()->acquire(path);
+
+        // The same folder written differently, or a removed root added back
+        if (m_roots.contains(root)) {
+            m_retiredRoots.removeOne(root);
+            WallpaperCatalog::self()->release(root);
+            continue;
+        }
+
+        m_roots.append(root);
+        connect(root, &CatalogRoot::changed, this, &AbstractImageListModel::slotRootChanged);
+    }
+}
+
+void AbstractImageListModel::releaseRoot(CatalogRoot *root)
+{
+    disconnect(root, nullptr, this, nullptr);
+    m_roots.removeOne(root);
+    m_retiredRoots.removeOne(root);
+
+    WallpaperCatalog::self()->release(root);
+}
+
+void AbstractImageListModel::releaseRetiredRoots()
+{
+    const auto retiredRoots = m_retiredRoots;
+
+    for (CatalogRoot *root : retiredRoots) {
+        if (!isCoveredByScanningRoot(root)) {
+            releaseRoot(root);
+        }
+    }
+}
+
+bool AbstractImageListModel::isCoveredByScanningRoot(const CatalogRoot *root) const
+{
+    return std::any_of(m_roots.cbegin(), m_roots.cend(), [root](const CatalogRoot *other) {
+        return other != root && other->scanning() && isInRoots(root->path(), {other->path()});
+    });
+}
+
+bool AbstractImageListModel::rootsScanning() const
+{
+    return std::any_of(m_roots.cbegin(), m_roots.cend(), [](const CatalogRoot *root) {
+        return root->scanning();
+    });
 }
 
 void AbstractImageListModel::slotHandleImageSizeFound(const QString &path, const QSize &size)
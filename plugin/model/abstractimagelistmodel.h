@@ -9,15 +9,27 @@
 
 #include <QAbstractListModel>
 #include <QCache>
+#include <QHash>
+#include <QSet>
 #include <QSize>
 
+#include <algorithm>
+#include <vector>
+
 #include "imageroles.h"
 
+class CatalogRoot;
 class QPixmap;
 class KFileItem;
+struct WallpaperChanges;
 
 /**
  * Base class for image list model.
+ *
+ * The rows are the wallpapers added by the user followed by the ones in the
+ * folders, which are shared with other models through WallpaperCatalog. Only
+ * what depends on the target size, like the preferred image of a package, is
+ * resolved by each model.
  */
 class AbstractImageListModel : public QAbstractListModel, public ImageRoles
 {
@@ -27,35 +39,107 @@ class AbstractImageListModel : public QAbstractListModel, public ImageRoles
 
 public:
     explicit AbstractImageListModel(const QSize &targetSize, QObject *parent = nullptr);
+    ~AbstractImageListModel() override;
 
     QHash<int, QByteArray> roleNames() const override;
 
     int count() const;
     virtual int indexOf(const QString &path) const = 0;
 
-    virtual void load(const QStringList &customPaths = {}) = 0;
     /**
-     * Reload when target size changes or a new package is installed
+     * Replaces the folders with @p customPaths. Folders already loaded by
+     * other models are not scanned again.
+     */
+    void load(const QStringList &customPaths = {});
+    /**
+     * Scans the folders again when a new package is installed
      */
     void reload();
 
+    /**
+     * Adds @p roots to the folders. Only the folders nobody has loaded yet
+     * are scanned.
+     */
+    void addRoots(const QStringList &roots);
+    /**
+     * Drops the rows that are in @p roots but not in any remaining root.
+     * Nothing is scanned. A root covered by a root that is still scanning
+     * keeps its rows until that root is loaded.
+     */
+    void removeRoots(const QStringList &roots);
+    /**
+     * @return @c true while roots added by addRoots are being scanned
+     */
+    bool scanning() const;
+
+    /**
+     * @return @c true if @p path is one of @p roots or inside one of them
+     */
+    static bool isInRoots(const QString &path, const QStringList &roots);
+
 public Q_SLOTS:
     virtual QStringList addBackground(const QString &path) = 0;
     /**
      * @return removed files that should be removed from \KDirWatch
      */
     virtual QStringList removeBackground(const QString &path) = 0;
+    /**
+     * Removes every wallpaper matching @p paths with as few row removals as
+     * possible. Unlike removeBackground, local files are not deleted.
+     *
+     * @return removed wallpapers
+     */
+    virtual QStringList removeBackgrounds(const QStringList &paths) = 0;
 
+    /**
+     * Picks the preferred images for @p size again, nothing is scanned
+     */
     void slotTargetSizeChanged(const QSize &size);
 
 Q_SIGNALS:
     void countChanged();
     void loaded(AbstractImageListModel *model);
+    void rootsScanned(AbstractImageListModel *model);
 
 protected:
     void asyncGetPreview(const QString &path, const QPersistentModelIndex &index) const;
     void asyncGetImageSize(const QString &path, const QPersistentModelIndex &index) const;
 
+    /**
+     * Replaces @p current with @p incoming, but only emits signals for rows
+     * that were actually removed, inserted or changed, so the cached previews
+     * and image sizes of the other rows survive a reload.
+     *
+     * @param key returns the unique identifier of an item
+     * @param same returns @c false when a kept item needs to be refreshed
+     */
+    template<typename T, typename KeyFunc, typename SameFunc>
+    void applyDiff(QList<T> &current, const QList<T> &incoming, KeyFunc key, SameFunc same);
+
+    /**
+     * Rebuilds the rows from the added wallpapers and the folders for the
+     * current target size
+     */
+    virtual void mergeRoots() = 0;
+
+    /**
+     * @return @p rows without duplicates and the wallpapers removed from
+     *         this model. Removed wallpapers no longer in @p rows are
+     *         forgotten.
+     */
+    template<typename T, typename KeyFunc>
+    QList<T> filterRemoved(const QList<T> &rows, KeyFunc key);
+
+    /**
+     * Watches the files of a wallpaper added by the user, which may be
+     * outside the folders
+     */
+    void watchAddedWallpaper(const QString &packageName);
+    /**
+     * Keeps a removed row from coming back with the rows of the folders
+     */
+    void markRemoved(const QString &packageName);
+
     bool m_loading = false;
 
     QSize m_screenshotSize;
@@ -69,7 +153,10 @@ protected:
 
     QHash<QString, bool> m_pendingDeletion;
     QStringList m_removableWallpapers;
-    QStringList m_customPaths;
+
+    QList<CatalogRoot *> m_roots;
+    // Wallpapers in the folders that are only removed from this model
+    QSet<QString> m_removed;
 
     friend class ImageProxyModel; // For m_removableWallpapers
 
@@ -77,6 +164,165 @@ private Q_SLOTS:
     void slotHandleImageSizeFound(const QString &path, const QSize &size);
     void slotHandlePreview(const KFileItem &item, const QPixmap &preview);
     void slotHandlePreviewFailed(const KFileItem &item);
+
+    void slotRootChanged();
+    void slotCatalogChangesFound(const WallpaperChanges &changes);
+
+private:
+    void acquireRoots(const QStringList &paths);
+    void releaseRoot(CatalogRoot *root);
+    /**
+     * Releases the removed roots whose covering root has finished scanning
+     */
+    void releaseRetiredRoots();
+    bool isCoveredByScanningRoot(const CatalogRoot *root) const;
+    bool rootsScanning() const;
+
+    bool m_applyingDiff = false;
+    bool m_scanning = false;
+
+    // Removed roots that are still listed until the root covering them is loaded
+    QList<CatalogRoot *> m_retiredRoots;
+
+    // Added wallpapers registered with the DirectoryWatcher of WallpaperCatalog
+    QStringList m_watchedWallpapers;
 };
 
+template<typename T, typename KeyFunc>
+QList<T> AbstractImageListModel::filterRemoved(const QList<T> &rows, KeyFunc key)
+{
+    QList<T> results;
+    results.reserve(rows.size());
+
+    QSet<QString> keys;
+    keys.reserve(rows.size());
+
+    for (const T &item : rows) {
+        const QString k = key(item);
+
+        if (keys.contains(k)) {
+            continue;
+        }
+
+        keys.insert(k);
+
+        if (!m_removed.contains(k)) {
+            results.append(item);
+        }
+    }
+
+    m_removed.intersect(keys);
+
+    return results;
+}
+
+template<typename T, typename KeyFunc, typename SameFunc>
+void AbstractImageListModel::applyDiff(QList<T> &current, const QList<T> &incoming, KeyFunc key, SameFunc same)
+{
+    m_applyingDiff = true;
+    bool rowsChanged = false;
+
+    QSet<QString> incomingKeys;
+    incomingKeys.reserve(incoming.size());
+
+    for (const T &item : incoming) {
+        incomingKeys.insert(key(item));
+    }
+
+    // Remove stale rows from the back, so the rows in front keep their positions
+    for (int last = current.size() - 1; last >= 0;) {
+        if (incomingKeys.contains(key(current.at(last)))) {
+            --last;
+            continue;
+        }
+
+        int first = last;
+
+        while (first > 0 && !incomingKeys.contains(key(current.at(first - 1)))) {
+            --first;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+
+        for (int i = first; i <= last; ++i) {
+            m_pendingDeletion.remove(key(current.at(i)));
+        }
+
+        current.erase(current.begin() + first, current.begin() + last + 1);
+
+        endRemoveRows();
+
+        rowsChanged = true;
+        last = first - 1;
+    }
+
+    QHash<QString, int> rows;
+    rows.reserve(current.size());
+
+    for (int i = 0; i < current.size(); ++i) {
+        rows.insert(key(current.at(i)), i);
+    }
+
+    // Refresh kept rows in place, and queue new items behind their predecessor
+    std::vector<std::pair<int, QList<T>>> batches;
+    int insertRow = 0;
+    bool previousIsNew = false;
+
+    for (const T &item : incoming) {
+        const QString k = key(item);
+        const auto it = rows.constFind(k);
+
+        if (it == rows.cend()) {
+            if (!previousIsNew) {
+                batches.emplace_back(insertRow, QList<T>());
+            }
+
+            batches.back().second.append(item);
+            rows.insert(k, -1); // Skip duplicates
+            previousIsNew = true;
+            continue;
+        }
+
+        const int row = it.value();
+
+        if (row < 0) {
+            continue;
+        }
+
+        if (!same(current.at(row), item)) {
+            current[row] = item;
+            Q_EMIT dataChanged(index(row, 0), index(row, 0));
+        }
+
+        insertRow = row + 1;
+        previousIsNew = false;
+    }
+
+    // Insert from the back, so the queued row numbers stay valid
+    std::stable_sort(batches.begin(), batches.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+
+    for (auto it = batches.crbegin(); it != batches.crend(); ++it) {
+        const int row = it->first;
+        const QList<T> &items = it->second;
+
+        beginInsertRows(QModelIndex(), row, row + items.size() - 1);
+
+        for (int i = 0; i < items.size(); ++i) {
+            current.insert(row + i, items.at(i));
+        }
+
+        endInsertRows();
+
+        rowsChanged = true;
+    }
+
+    m_applyingDiff = false;
+
+    if (rowsChanged) {
+        Q_EMIT countChanged();
+    }
+}
+
 #endif // ABSTRACTIMAGELISTMODEL_H
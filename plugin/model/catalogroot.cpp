@@ -0,0 +1,268 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "catalogroot.h"
+
+#include <QDir>
+#include <QThreadPool>
+
+#include <algorithm>
+
+#include "../finder/filechangefinder.h"
+#include "../finder/imagefinder.h"
+#include "abstractimagelistmodel.h"
+#include "directorywatcher.h"
+#include "wallpapercatalog.h"
+
+CatalogRoot::CatalogRoot(const QString &path, DirectoryWatcher *dirWatch, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_dirWatch(dirWatch)
+{
+}
+
+CatalogRoot::~CatalogRoot()
+{
+    for (const QString &path : std::as_const(m_watchedPaths)) {
+        m_dirWatch->removePath(path);
+    }
+}
+
+QString CatalogRoot::path() const
+{
+    return m_path;
+}
+
+void CatalogRoot::scan()
+{
+    if (scanning()) {
+        return;
+    }
+
+    const QStringList paths{m_path};
+    m_runningFinders = 3;
+
+    // The preferred images are picked by each model, so no target size here
+    auto imageFinder = new ImageFinder(paths);
+    connect(imageFinder, &ImageFinder::imageFound, this, [this](const QStringList &images) {
+        m_images = images;
+        finishScan();
+    });
+    QThreadPool::globalInstance()->start(imageFinder);
+
+    auto packageFinder = new PackageFinder(paths, QSize());
+    connect(packageFinder, &PackageFinder::packageFound, this, [this](const QList<WallpaperPackage> &packages) {
+        m_packages = packages;
+        finishScan();
+    });
+    QThreadPool::globalInstance()->start(packageFinder);
+
+    auto xmlFinder = new XmlFinder(paths, QSize());
+    connect(xmlFinder, &XmlFinder::xmlFound, this, [this](const QList<WallpaperItem> &items) {
+        m_xmlItems = items;
+        finishScan();
+    });
+    QThreadPool::globalInstance()->start(xmlFinder);
+}
+
+void CatalogRoot::copyFrom(const CatalogRoot &parent)
+{
+    const QStringList roots{m_path};
+
+    m_images.clear();
+    std::copy_if(parent.m_images.cbegin(), parent.m_images.cend(), std::back_inserter(m_images), [&roots](const QString &path) {
+        return AbstractImageListModel::isInRoots(path, roots);
+    });
+
+    m_packages.clear();
+    std::copy_if(parent.m_packages.cbegin(), parent.m_packages.cend(), std::back_inserter(m_packages), [&roots](const WallpaperPackage &package) {
+        return AbstractImageListModel::isInRoots(package.path, roots);
+    });
+
+    m_xmlItems.clear();
+    std::copy_if(parent.m_xmlItems.cbegin(), parent.m_xmlItems.cend(), std::back_inserter(m_xmlItems), [&roots](const WallpaperItem &item) {
+        return AbstractImageListModel::isInRoots(item._root, roots);
+    });
+
+    m_loaded = true;
+    updateWatchedPaths();
+}
+
+bool CatalogRoot::isLoaded() const
+{
+    return m_loaded;
+}
+
+bool CatalogRoot::scanning() const
+{
+    return m_runningFinders > 0;
+}
+
+const QStringList &CatalogRoot::images() const
+{
+    return m_images;
+}
+
+const QList<WallpaperPackage> &CatalogRoot::packages() const
+{
+    return m_packages;
+}
+
+const QList<WallpaperItem> &CatalogRoot::xmlItems() const
+{
+    return m_xmlItems;
+}
+
+void CatalogRoot::applyChanges(const WallpaperChanges &changes)
+{
+    // Only loaded wallpapers can be changed, a running scan sees the files anyway
+    if (!m_loaded) {
+        return;
+    }
+
+    const QStringList roots{m_path};
+    const int imageCount = m_images.size();
+    const int packageCount = m_packages.size();
+    const int xmlCount = m_xmlItems.size();
+    bool modified = false;
+
+    if (!changes.deleted.empty()) {
+        const QSet<QString> deleted(changes.deleted.cbegin(), changes.deleted.cend());
+        QSet<QString> deletedFolders;
+
+        for (const QString &path : changes.deleted) {
+            deletedFolders.insert(path.endsWith(QDir::separator()) ? path : path + QDir::separator());
+        }
+
+        m_images.erase(std::remove_if(m_images.begin(),
+                                      m_images.end(),
+                                      [&deleted](const QString &path) {
+                                          return deleted.contains(path);
+                                      }),
+                       m_images.end());
+        m_packages.erase(std::remove_if(m_packages.begin(),
+                                        m_packages.end(),
+                                        [&deletedFolders](const WallpaperPackage &package) {
+                                            return deletedFolders.contains(package.path);
+                                        }),
+                         m_packages.end());
+        // Removing the XML file or the image removes the wallpaper, too.
+        m_xmlItems.erase(std::remove_if(m_xmlItems.begin(),
+                                        m_xmlItems.end(),
+                                        [&deleted](const WallpaperItem &item) {
+                                            return deleted.contains(item.path.toString()) || deleted.contains(item._root) || deleted.contains(item.filename);
+                                        }),
+                         m_xmlItems.end());
+
+        modified = m_images.size() != imageCount || m_packages.size() != packageCount || m_xmlItems.size() != xmlCount;
+    }
+
+    // New wallpapers go first, like the ones added by the user
+    QSet<QString> existing(m_images.cbegin(), m_images.cend());
+    QStringList images;
+
+    for (const QString &path : changes.images) {
+        if (isInRootsAndNew(path, roots, existing)) {
+            images.append(path);
+        }
+    }
+
+    existing.clear();
+    for (const WallpaperPackage &package : std::as_const(m_packages)) {
+        existing.insert(package.path);
+    }
+
+    QList<WallpaperPackage> packages;
+
+    for (const WallpaperPackage &package : changes.packages) {
+        if (isInRootsAndNew(package.path, roots, existing)) {
+            packages.append(package);
+        }
+    }
+
+    existing.clear();
+    for (const WallpaperItem &item : std::as_const(m_xmlItems)) {
+        existing.insert(item.path.toString());
+    }
+
+    QList<WallpaperItem> xmlItems;
+
+    for (const WallpaperItem &item : changes.xmlItems) {
+        if (AbstractImageListModel::isInRoots(item._root, roots) && !existing.contains(item.path.toString())) {
+            existing.insert(item.path.toString());
+            xmlItems.append(item);
+        }
+    }
+
+    if (!images.empty() || !packages.empty() || !xmlItems.empty()) {
+        m_images = images + m_images;
+        m_packages = packages + m_packages;
+        m_xmlItems = xmlItems + m_xmlItems;
+        modified = true;
+    }
+
+    if (modified) {
+        updateWatchedPaths();
+        Q_EMIT changed(this);
+    }
+}
+
+bool CatalogRoot::isInRootsAndNew(const QString &path, const QStringList &roots, QSet<QString> &existing)
+{
+    if (!AbstractImageListModel::isInRoots(path, roots) || existing.contains(path)) {
+        return false;
+    }
+
+    existing.insert(path);
+    return true;
+}
+
+void CatalogRoot::finishScan()
+{
+    if (--m_runningFinders > 0) {
+        return;
+    }
+
+    m_loaded = true;
+    updateWatchedPaths();
+
+    Q_EMIT changed(this);
+}
+
+void CatalogRoot::updateWatchedPaths()
+{
+    QSet<QString> paths;
+
+    for (const QString &path : std::as_const(m_images)) {
+        paths.insert(path);
+    }
+
+    for (const WallpaperPackage &package : std::as_const(m_packages)) {
+        paths.insert(package.path);
+    }
+
+    for (const WallpaperItem &item : std::as_const(m_xmlItems)) {
+        const QStringList itemPaths = WallpaperCatalog::watchedPaths(item.path.toString());
+
+        for (const QString &path : itemPaths) {
+            paths.insert(path);
+        }
+    }
+
+    for (const QString &path : std::as_const(m_watchedPaths)) {
+        if (!paths.contains(path)) {
+            m_dirWatch->removePath(path);
+        }
+    }
+
+    for (const QString &path : std::as_const(paths)) {
+        if (!m_watchedPaths.contains(path)) {
+            m_dirWatch->addPath(path);
+        }
+    }
+
+    m_watchedPaths = paths;
+}
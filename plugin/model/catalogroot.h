@@ -0,0 +1,91 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef CATALOGROOT_H
+#define CATALOGROOT_H
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+#include "../finder/packagefinder.h"
+#include "../finder/xmlfinder.h"
+
+class DirectoryWatcher;
+struct WallpaperChanges;
+
+/**
+ * The wallpapers found in one folder, shared by every model that lists it.
+ *
+ * Nothing here depends on the target size: packages keep all their images
+ * and XML wallpapers all the sizes of their images, and each model picks the
+ * preferred ones for its own size.
+ */
+class CatalogRoot : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CatalogRoot(const QString &path, DirectoryWatcher *dirWatch, QObject *parent = nullptr);
+    ~CatalogRoot() override;
+
+    QString path() const;
+
+    /**
+     * Scans the folder again, unless a scan is already running
+     */
+    void scan();
+    /**
+     * Takes the wallpapers inside this folder from the loaded @p parent
+     * instead of scanning it.
+     */
+    void copyFrom(const CatalogRoot &parent);
+
+    bool isLoaded() const;
+    bool scanning() const;
+
+    const QStringList &images() const;
+    const QList<WallpaperPackage> &packages() const;
+    const QList<WallpaperItem> &xmlItems() const;
+
+    /**
+     * Adds the created wallpapers inside this folder and drops the deleted
+     * ones.
+     */
+    void applyChanges(const WallpaperChanges &changes);
+
+Q_SIGNALS:
+    /**
+     * Emitted when a scan is done or the wallpapers have changed
+     */
+    void changed(CatalogRoot *root);
+
+private:
+    void finishScan();
+    /**
+     * @return @c true if @p path is in @p roots and not in @p existing yet,
+     *         in which case it is added to @p existing
+     */
+    static bool isInRootsAndNew(const QString &path, const QStringList &roots, QSet<QString> &existing);
+    /**
+     * Registers the files of the wallpapers with DirectoryWatcher
+     */
+    void updateWatchedPaths();
+
+    QString m_path;
+    DirectoryWatcher *m_dirWatch;
+
+    bool m_loaded = false;
+    int m_runningFinders = 0;
+
+    QStringList m_images;
+    QList<WallpaperPackage> m_packages;
+    QList<WallpaperItem> m_xmlItems;
+
+    QSet<QString> m_watchedPaths;
+};
+
+#endif // CATALOGROOT_H
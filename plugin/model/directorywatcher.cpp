@@ -0,0 +1,242 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "directorywatcher.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <limits>
+
+static bool isInside(const QString &path, const QString &folder)
+{
+    // The folder itself ends with a separator for "/"
+    return path.startsWith(folder) && (path.size() == folder.size() || folder.endsWith(QLatin1Char('/')) || path.at(folder.size()) == QLatin1Char('/'));
+}
+
+DirectoryWatcher::DirectoryWatcher(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_dirWatch, &KDirWatch::created, this, &DirectoryWatcher::slotCreated);
+    connect(&m_dirWatch, &KDirWatch::deleted, this, &DirectoryWatcher::slotDeleted);
+
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &DirectoryWatcher::slotFlush);
+}
+
+void DirectoryWatcher::addRoot(const QString &_path)
+{
+    const QString path = QDir::cleanPath(_path);
+
+    if (m_roots.contains(path)) {
+        return;
+    }
+
+    m_roots.append(path);
+    m_dirWatch.addDir(path, KDirWatch::WatchFiles | KDirWatch::WatchSubDirs);
+    m_watchCount++;
+}
+
+void DirectoryWatcher::removeRoot(const QString &_path)
+{
+    const QString path = QDir::cleanPath(_path);
+
+    if (m_roots.removeOne(path)) {
+        m_dirWatch.removeDir(path);
+        m_watchCount--;
+    }
+}
+
+void DirectoryWatcher::addPath(const QString &_path)
+{
+    const QString path = QDir::cleanPath(_path);
+
+    if (auto it = m_paths.find(path); it != m_paths.end()) {
+        it->refCount++;
+        return;
+    }
+
+    Entry entry;
+    entry.refCount = 1;
+
+    if (!isCoveredByRoot(path)) {
+        // A package is a folder itself, a file shares the watch on its folder.
+        const QFileInfo info(path);
+        entry.directory = info.isDir() ? path : info.absolutePath();
+        watchDirectory(entry.directory);
+    }
+
+    m_paths.insert(path, entry);
+}
+
+void DirectoryWatcher::removePath(const QString &_path)
+{
+    const QString path = QDir::cleanPath(_path);
+
+    auto it = m_paths.find(path);
+
+    if (it == m_paths.end()) {
+        return;
+    }
+
+    if (--it->refCount > 0) {
+        return;
+    }
+
+    const QString directory = it->directory;
+    m_paths.erase(it);
+
+    if (!directory.isEmpty()) {
+        unwatchDirectory(directory);
+    }
+}
+
+bool DirectoryWatcher::contains(const QString &_path) const
+{
+    const QString path = QDir::cleanPath(_path);
+
+    return m_roots.contains(path) || m_paths.contains(path);
+}
+
+int DirectoryWatcher::watchCount() const
+{
+    return m_watchCount;
+}
+
+void DirectoryWatcher::setDebounceInterval(int msec)
+{
+    m_debounceInterval = std::max(0, msec);
+}
+
+void DirectoryWatcher::slotCreated(const QString &_path)
+{
+    const QString path = QDir::cleanPath(_path);
+
+    // Folders outside the roots are only watched for known wallpapers
+    if (isCoveredByRoot(path) || m_paths.contains(path)) {
+        enqueue(path, true);
+    }
+}
+
+void DirectoryWatcher::slotDeleted(const QString &_path)
+{
+    const QString path = QDir::cleanPath(_path);
+
+    if (isCoveredByRoot(path) || m_paths.contains(path)) {
+        enqueue(path, false);
+    }
+
+    // A removed folder takes every registered path below it.
+    const QString prefix = path.endsWith(QLatin1Char('/')) ? path : path + QLatin1Char('/');
+    QStringList children;
+
+    for (auto it = m_paths.lowerBound(prefix); it != m_paths.cend() && it.key().startsWith(prefix); it++) {
+        children.append(it.key());
+    }
+
+    for (const QString &child : std::as_const(children)) {
+        enqueue(child, false);
+    }
+}
+
+bool DirectoryWatcher::isCoveredByRoot(const QString &path) const
+{
+    return std::any_of(m_roots.cbegin(), m_roots.cend(), [&path](const QString &root) {
+        return isInside(path, root);
+    });
+}
+
+void DirectoryWatcher::watchDirectory(const QString &directory)
+{
+    if (m_directories[directory]++ == 0) {
+        m_dirWatch.addDir(directory, KDirWatch::WatchFiles);
+        m_watchCount++;
+    }
+}
+
+void DirectoryWatcher::unwatchDirectory(const QString &directory)
+{
+    auto it = m_directories.find(directory);
+
+    if (it == m_directories.end()) {
+        return;
+    }
+
+    if (--it.value() == 0) {
+        m_directories.erase(it);
+        m_dirWatch.removeDir(directory);
+        m_watchCount--;
+    }
+}
+
+void DirectoryWatcher::enqueue(const QString &path, bool isCreated)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const QString directory = path.left(path.lastIndexOf(QLatin1Char('/')));
+
+    PendingChanges &changes = m_pendingChanges[directory];
+
+    if (changes.firstEvent == 0) {
+        changes.firstEvent = now;
+    }
+    changes.lastEvent = now;
+
+    // Only the last event of a path matters
+    if (isCreated) {
+        changes.deleted.remove(path);
+        changes.created.insert(path);
+    } else {
+        changes.created.remove(path);
+        changes.deleted.insert(path);
+    }
+
+    scheduleFlush();
+}
+
+void DirectoryWatcher::scheduleFlush()
+{
+    if (m_pendingChanges.empty()) {
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 nextFlush = std::numeric_limits<qint64>::max();
+
+    for (auto it = m_pendingChanges.cbegin(); it != m_pendingChanges.cend(); it++) {
+        const qint64 deadline = std::min(it->lastEvent + m_debounceInterval, it->firstEvent + 4 * m_debounceInterval);
+        nextFlush = std::min(nextFlush, deadline);
+    }
+
+    m_flushTimer.start(std::max<qint64>(0, nextFlush - now));
+}
+
+void DirectoryWatcher::slotFlush()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QStringList created;
+    QStringList deleted;
+
+    for (auto it = m_pendingChanges.begin(); it != m_pendingChanges.end();) {
+        const qint64 deadline = std::min(it->lastEvent + m_debounceInterval, it->firstEvent + 4 * m_debounceInterval);
+
+        if (deadline > now) {
+            it++;
+            continue;
+        }
+
+        created += it->created.values();
+        deleted += it->deleted.values();
+        it = m_pendingChanges.erase(it);
+    }
+
+    scheduleFlush();
+
+    if (!created.empty() || !deleted.empty()) {
+        Q_EMIT changed(created, deleted);
+    }
+}
@@ -0,0 +1,113 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef DIRECTORYWATCHER_H
+#define DIRECTORYWATCHER_H
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+#include <KDirWatch>
+
+/**
+ * Watches wallpapers through their containing directories instead of
+ * adding one KDirWatch entry per file.
+ *
+ * Root folders are watched recursively. A wallpaper outside the roots costs
+ * at most one watch on its folder (or on itself for a package), shared with
+ * every other wallpaper in the same folder. Events are mapped back to the
+ * registered paths through a sorted index.
+ *
+ * Events are debounced per folder and reported in batches, so a burst of
+ * changes (e.g. extracting an archive) costs one update instead of one per
+ * file.
+ */
+class DirectoryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DirectoryWatcher(QObject *parent = nullptr);
+
+    /**
+     * Watches @p path and all its subfolders, new files inside are reported.
+     */
+    void addRoot(const QString &path);
+    void removeRoot(const QString &path);
+
+    /**
+     * Registers a file or a package folder. Registering the same path more
+     * than once requires the same number of removePath calls.
+     */
+    void addPath(const QString &path);
+    void removePath(const QString &path);
+
+    /**
+     * @return @c true if @p path is a root or a registered path
+     */
+    bool contains(const QString &path) const;
+
+    /**
+     * @return the number of folders added to KDirWatch. The subfolders of a
+     * root are watched by KDirWatch itself and not counted.
+     */
+    int watchCount() const;
+
+    /**
+     * Time to wait after the last event in a folder before reporting it.
+     * Changes are reported after at most 4 * @p msec if the folder keeps
+     * changing.
+     */
+    void setDebounceInterval(int msec);
+
+Q_SIGNALS:
+    /**
+     * Emitted with the paths changed in every settled folder
+     */
+    void changed(const QStringList &created, const QStringList &deleted);
+
+private Q_SLOTS:
+    void slotCreated(const QString &path);
+    void slotDeleted(const QString &path);
+    void slotFlush();
+
+private:
+    struct Entry {
+        int refCount = 0;
+        QString directory; // Empty when covered by a root
+    };
+
+    struct PendingChanges {
+        QSet<QString> created;
+        QSet<QString> deleted;
+        qint64 firstEvent = 0;
+        qint64 lastEvent = 0;
+    };
+
+    bool isCoveredByRoot(const QString &path) const;
+    void watchDirectory(const QString &directory);
+    void unwatchDirectory(const QString &directory);
+
+    void enqueue(const QString &path, bool isCreated);
+    void scheduleFlush();
+
+    KDirWatch m_dirWatch;
+
+    QStringList m_roots;
+    QMap<QString, Entry> m_paths;
+    QHash<QString, int> m_directories;
+    int m_watchCount = 0; // Roots and folders added to m_dirWatch
+
+    QHash<QString, PendingChanges> m_pendingChanges;
+    QTimer m_flushTimer;
+    int m_debounceInterval = 250;
+};
+
+#endif // DIRECTORYWATCHER_H
@@ -9,14 +9,13 @@
 
 #include <QFileInfo>
 #include <QPixmap>
-#include <QThreadPool>
 #include <QStandardPaths>
 #include <QUrl>
 
 #include <KIO/PreviewJob>
 
-#include "../finder/imagefinder.h"
 #include "../finder/suffixcheck.h"
+#include "catalogroot.h"
 
 ImageListModel::ImageListModel(const QSize &targetSize, QObject *parent)
     : AbstractImageListModel(targetSize, parent)
@@ -122,35 +121,25 @@ int ImageListModel::indexOf(const QString &_path) const
     return std::distance(m_data.cbegin(), it);
 }
 
-void ImageListModel::load(const QStringList &customPaths)
+void ImageListModel::mergeRoots()
 {
-    if (m_loading || customPaths.empty()) {
-        return;
-    }
-
-    m_customPaths = customPaths;
-    m_customPaths.removeDuplicates();
-
-    ImageFinder *finder = new ImageFinder(m_customPaths);
-    connect(finder, &ImageFinder::imageFound, this, &ImageListModel::slotHandleImageFound);
-    QThreadPool::globalInstance()->start(finder);
-
-    m_loading = true;
-}
-
-void ImageListModel::slotHandleImageFound(const QStringList &paths)
-{
-    beginResetModel();
+    QStringList rows = m_added;
 
-    m_data = paths;
-
-    m_imageCache.clear();
-    m_imageSizeCache.clear();
-
-    endResetModel();
+    for (const CatalogRoot *root : std::as_const(m_roots)) {
+        rows += root->images();
+    }
 
-    m_loading = false;
-    Q_EMIT loaded(this);
+    const auto key = [](const QString &path) {
+        return path;
+    };
+
+    applyDiff(
+        m_data,
+        filterRemoved(rows, key),
+        key,
+        [](const QString &, const QString &) {
+            return true;
+        });
 }
 
 QStringList ImageListModel::addBackground(const QString &path)
@@ -171,6 +160,10 @@ QStringList ImageListModel::addBackground(const QString &path)
 
     endInsertRows();
 
+    m_added.prepend(path);
+    m_removed.remove(path);
+    watchAddedWallpaper(path);
+
     return {path};
 }
 
@@ -192,6 +185,8 @@ QStringList ImageListModel::removeBackground(const QString &path)
 
     m_pendingDeletion.remove(m_data.at(idx));
     m_removableWallpapers.removeOne(m_data.at(idx));
+    m_added.removeOne(m_data.at(idx));
+    markRemoved(m_data.at(idx));
     results.append(m_data.takeAt(idx));
 
     // Remove local wallpaper
@@ -207,3 +202,48 @@ QStringList ImageListModel::removeBackground(const QString &path)
 
     return results;
 }
+
+QStringList ImageListModel::removeBackgrounds(const QStringList &paths)
+{
+    const QSet<QString> pathSet(paths.cbegin(), paths.cend());
+    QStringList remaining;
+    QStringList results;
+
+    for (const QString &path : std::as_const(m_data)) {
+        if (pathSet.contains(path)) {
+            results.append(path);
+        } else {
+            remaining.append(path);
+        }
+    }
+
+    if (results.empty()) {
+        return results;
+    }
+
+    const QSet<QString> resultSet(results.cbegin(), results.cend());
+
+    for (const QString &path : std::as_const(results)) {
+        m_added.removeOne(path);
+        markRemoved(path);
+    }
+
+    m_removableWallpapers.erase(std::remove_if(m_removableWallpapers.begin(),
+                                               m_removableWallpapers.end(),
+                                               [&resultSet](const QString &path) {
+                                                   return resultSet.contains(path);
+                                               }),
+                                m_removableWallpapers.end());
+
+    applyDiff(
+        m_data,
+        remaining,
+        [](const QString &path) {
+            return path;
+        },
+        [](const QString &, const QString &) {
+            return true;
+        });
+
+    return results;
+}
@@ -26,17 +26,18 @@ public:
 
     int indexOf(const QString &path) const override;
 
-    void load(const QStringList &customPaths = {}) override;
-
 public Q_SLOTS:
     QStringList addBackground(const QString &path) override;
     QStringList removeBackground(const QString &path) override;
+    QStringList removeBackgrounds(const QStringList &paths) override;
 
-protected Q_SLOTS:
-    void slotHandleImageFound(const QStringList &paths);
+protected:
+    void mergeRoots() override;
 
 private:
     QStringList m_data;
+    // Added by the user, newest first
+    QStringList m_added;
 
     friend class ImageListModelTest;
 };
@@ -13,10 +13,13 @@
 #include <KIO/OpenFileManagerWindowJob>
 #include <KSharedConfig>
 
+#include <algorithm>
+
 #include "../finder/suffixcheck.h"
 #include "../finder/xmlfinder.h"
 #include "imagelistmodel.h"
 #include "packagelistmodel.h"
+#include "wallpapercatalog.h"
 #include "xmlimagelistmodel.h"
 
 ImageProxyModel::ImageProxyModel(const QStringList &_customPaths, const QSize &targetSize, QObject *parent)
@@ -29,19 +32,9 @@ ImageProxyModel::ImageProxyModel(const QStringList &_customPaths, const QSize &t
     connect(this, &ImageProxyModel::rowsRemoved, this, &ImageProxyModel::countChanged);
     connect(this, &ImageProxyModel::modelReset, this, &ImageProxyModel::countChanged);
 
-    /**
-     * Add files to KDirWatch.
-     * Files or dirs should be already added to KDirWatch when
-     * rowsInserted or rowsRemoved is emitted.
-     */
-    connect(m_imageModel, &QAbstractItemModel::modelAboutToBeReset, this, &ImageProxyModel::slotSourceModelAboutToBeReset);
-    connect(m_packageModel, &QAbstractItemModel::modelAboutToBeReset, this, &ImageProxyModel::slotSourceModelAboutToBeReset);
-    connect(m_xmlModel, &QAbstractItemModel::modelAboutToBeReset, this, &ImageProxyModel::slotSourceModelAboutToBeReset);
-    connect(m_imageModel, &QAbstractItemModel::modelReset, this, &ImageProxyModel::slotSourceModelReset);
-    connect(m_packageModel, &QAbstractItemModel::modelReset, this, &ImageProxyModel::slotSourceModelReset);
-    connect(m_xmlModel, &QAbstractItemModel::modelReset, this, &ImageProxyModel::slotSourceModelReset);
-
-    // Monitor file changes in the custom directories for the slideshow backend.
+    // The source models drop deleted wallpapers first
+    connect(WallpaperCatalog::self(), &WallpaperCatalog::changesFound, this, &ImageProxyModel::slotCatalogChangesFound);
+
     QStringList customPaths = _customPaths;
 
     if (customPaths.empty()) {
@@ -58,18 +51,31 @@ ImageProxyModel::ImageProxyModel(const QStringList &_customPaths, const QSize &t
     }
 
     for (const QString &path : std::as_const(customPaths)) {
-        if (QFileInfo(path).isDir()) {
-            m_dirWatch.addDir(path, KDirWatch::WatchFiles | KDirWatch::WatchSubDirs);
-        }
+        m_roots.append(normalizedRoot(path));
     }
+    m_roots.removeDuplicates();
 
-    connect(&m_dirWatch, &KDirWatch::created, this, &ImageProxyModel::slotDirWatchCreated);
-    connect(&m_dirWatch, &KDirWatch::deleted, this, &ImageProxyModel::slotDirWatchDeleted);
+    // Overlapping folders are only scanned and watched once
+    customPaths = minimalRoots(customPaths);
 
     connect(m_imageModel, &AbstractImageListModel::loaded, this, &ImageProxyModel::slotHandleLoaded);
     connect(m_packageModel, &AbstractImageListModel::loaded, this, &ImageProxyModel::slotHandleLoaded);
     connect(m_xmlModel, &AbstractImageListModel::loaded, this, &ImageProxyModel::slotHandleLoaded);
 
+    connect(m_imageModel, &AbstractImageListModel::rootsScanned, this, &ImageProxyModel::loadingChanged);
+    connect(m_packageModel, &AbstractImageListModel::rootsScanned, this, &ImageProxyModel::loadingChanged);
+    connect(m_xmlModel, &AbstractImageListModel::rootsScanned, this, &ImageProxyModel::loadingChanged);
+
+    // Only the preferred images are picked again, so no need to wait for the models
+    connect(this, &ImageProxyModel::targetSizeChanged, m_imageModel, &AbstractImageListModel::slotTargetSizeChanged);
+    connect(this, &ImageProxyModel::targetSizeChanged, m_packageModel, &AbstractImageListModel::slotTargetSizeChanged);
+    connect(this, &ImageProxyModel::targetSizeChanged, m_xmlModel, &AbstractImageListModel::slotTargetSizeChanged);
+
+    // The models are still empty, rows will be inserted when each finder is done.
+    addSourceModel(m_imageModel);
+    addSourceModel(m_packageModel);
+    addSourceModel(m_xmlModel);
+
     m_imageModel->load(customPaths);
     m_packageModel->load(customPaths);
     m_xmlModel->load(customPaths);
@@ -110,7 +116,12 @@ int ImageProxyModel::indexOf(const QString &packagePath) const
 
 bool ImageProxyModel::loading() const
 {
-    return m_loaded != 3;
+    return m_loaded != 3 || m_imageModel->scanning() || m_packageModel->scanning() || m_xmlModel->scanning();
+}
+
+qreal ImageProxyModel::loadingProgress() const
+{
+    return m_loaded / 3.0;
 }
 
 void ImageProxyModel::reload()
@@ -122,6 +133,119 @@ void ImageProxyModel::reload()
     }
 }
 
+void ImageProxyModel::addRoots(const QStringList &_roots)
+{
+    const QStringList oldRoots = minimalRoots(m_roots);
+
+    for (const QString &root : _roots) {
+        if (const QString r = normalizedRoot(root); !m_roots.contains(r)) {
+            m_roots.append(r);
+        }
+    }
+
+    QStringList addedRoots;
+    const QStringList newRoots = minimalRoots(m_roots);
+    std::copy_if(newRoots.cbegin(), newRoots.cend(), std::back_inserter(addedRoots), [&oldRoots](const QString &root) {
+        return !oldRoots.contains(root);
+    });
+
+    if (addedRoots.empty()) {
+        return;
+    }
+
+    // A new parent folder replaces its children
+    QStringList coveredRoots;
+    std::copy_if(oldRoots.cbegin(), oldRoots.cend(), std::back_inserter(coveredRoots), [&newRoots](const QString &root) {
+        return !newRoots.contains(root);
+    });
+
+    const auto models = sourceModels();
+
+    for (const auto &m : models) {
+        auto model = static_cast<AbstractImageListModel *>(m);
+        model->addRoots(addedRoots);
+        model->removeRoots(coveredRoots);
+    }
+
+    Q_EMIT loadingChanged();
+}
+
+void ImageProxyModel::removeRoots(const QStringList &_roots)
+{
+    const QStringList oldRoots = minimalRoots(m_roots);
+
+    for (const QString &root : _roots) {
+        m_roots.removeAll(normalizedRoot(root));
+    }
+
+    const QStringList newRoots = minimalRoots(m_roots);
+    QStringList removedRoots;
+    QStringList exposedRoots;
+
+    std::copy_if(oldRoots.cbegin(), oldRoots.cend(), std::back_inserter(removedRoots), [&newRoots](const QString &root) {
+        return !newRoots.contains(root);
+    });
+    std::copy_if(newRoots.cbegin(), newRoots.cend(), std::back_inserter(exposedRoots), [&oldRoots](const QString &root) {
+        return !oldRoots.contains(root);
+    });
+
+    if (removedRoots.empty()) {
+        return;
+    }
+
+    const auto models = sourceModels();
+
+    // The parent folder is still loaded, so a child folder is taken from it
+    // instead of being scanned again
+    for (const auto &m : models) {
+        auto model = static_cast<AbstractImageListModel *>(m);
+        model->addRoots(exposedRoots);
+        model->removeRoots(removedRoots);
+    }
+}
+
+QStringList ImageProxyModel::roots() const
+{
+    return m_roots;
+}
+
+QStringList ImageProxyModel::minimalRoots(const QStringList &paths)
+{
+    QStringList folders;
+
+    for (const QString &path : paths) {
+        if (QFileInfo(path).isDir()) {
+            folders.append(QDir::cleanPath(path));
+        }
+    }
+
+    QStringList results;
+
+    for (const QString &path : paths) {
+        const QString p = normalizedRoot(path);
+
+        const bool covered = std::any_of(folders.cbegin(), folders.cend(), [&p](const QString &folder) {
+            return p.startsWith(folder + QLatin1Char('/'));
+        });
+
+        if (!covered && !results.contains(p)) {
+            results.append(p);
+        }
+    }
+
+    return results;
+}
+
+QString ImageProxyModel::normalizedRoot(const QString &path)
+{
+    // Keep URLs like the ones of XML wallpapers as is
+    if (path.contains(QLatin1String("://"))) {
+        return path;
+    }
+
+    return QDir::cleanPath(path);
+}
+
 QStringList ImageProxyModel::addBackground(const QString &_path)
 {
     QString path = _path;
@@ -154,35 +278,7 @@ QStringList ImageProxyModel::addBackground(const QString &_path)
         }
     }
 
-    if (!results.empty()) {
-        m_pendingAddition.append(results);
-
-        std::for_each(results.cbegin(), results.cend(), [this](const QString &path) {
-            if (QUrl url(path); url.scheme() == QStringLiteral("image") && url.host() == QStringLiteral("gnome-wp-list")) {
-                const QStringList paths = XmlFinder::convertToPaths(url);
-
-                for (const QString &p : paths) {
-                    if (!m_dirWatch.contains(p)) {
-                        m_dirWatch.addFile(p);
-                    }
-                }
-
-                return;
-            }
-
-            if (m_dirWatch.contains(path)) {
-                return;
-            }
-
-            const QFileInfo info(path);
-
-            if (info.isFile()) {
-                m_dirWatch.addFile(path);
-            } else if (info.isDir()) {
-                m_dirWatch.addDir(path);
-            }
-        });
-    }
+    m_pendingAddition.append(results);
 
     return results;
 }
@@ -197,38 +293,16 @@ void ImageProxyModel::removeBackground(const QString &_packagePath)
 
     QStringList results;
 
-    // XML wallpaper
-    const auto removeXmlBackground = [this, &packagePath, &results] {
-        results = m_xmlModel->removeBackground(packagePath);
-
-        if (!results.empty()){
-            const QStringList paths = XmlFinder::convertToPaths(QUrl(results.at(0)));
-
-            for (const QString &p : paths) {
-                m_dirWatch.removeFile(p);
-            }
-        }
-    };
-
     if (QUrl url(packagePath); url.scheme() == QStringLiteral("image") && url.host() == QStringLiteral("gnome-wp-list")) {
-        removeXmlBackground();
-    }
-
-    // The file may be already deleted, so isFile/isDir won't work.
-    if (QFileInfo info(packagePath); isAcceptableSuffix(info.suffix())) {
+        // XML wallpaper
+        results = m_xmlModel->removeBackground(packagePath);
+    } else if (QFileInfo info(packagePath); isAcceptableSuffix(info.suffix())) {
+        // The file may be already deleted, so isFile/isDir won't work.
         results = m_imageModel->removeBackground(packagePath);
-
-        if (!results.empty()){
-            m_dirWatch.removeFile(results.at(0));
-        }
     } else if (info.suffix().toLower() == QStringLiteral("xml")) {
-        removeXmlBackground();
+        results = m_xmlModel->removeBackground(packagePath);
     } else {
         results = m_packageModel->removeBackground(packagePath);
-
-        if (!results.empty()) {
-            m_dirWatch.removeFile(results.at(0));
-        }
     }
 
     // The user may add a wallpaper and delete it later.
@@ -308,98 +382,16 @@ void ImageProxyModel::slotHandleLoaded(AbstractImageListModel *model)
 {
     disconnect(model, &AbstractImageListModel::loaded, this, 0);
 
-    if (++m_loaded == 3) {
-        // All models are loaded, now add them.
-        addSourceModel(m_imageModel);
-        addSourceModel(m_packageModel);
-        addSourceModel(m_xmlModel);
-
-        connect(this, &ImageProxyModel::targetSizeChanged, m_imageModel, &AbstractImageListModel::slotTargetSizeChanged);
-        connect(this, &ImageProxyModel::targetSizeChanged, m_packageModel, &AbstractImageListModel::slotTargetSizeChanged);
-        connect(this, &ImageProxyModel::targetSizeChanged, m_xmlModel, &AbstractImageListModel::slotTargetSizeChanged);
-
-        Q_EMIT loadingChanged();
-    }
-}
-
-void ImageProxyModel::slotSourceModelAboutToBeReset()
-{
-    AbstractImageListModel *model = qobject_cast<AbstractImageListModel *>(this->sender());
-
-    if (!model) {
-        return;
-    }
-
-    // Delete all items in KDirWatch
-    for (int i = 0; i < model->rowCount(); i++) {
-        const QString packageName = model->index(i, 0).data(ImageRoles::PackageNameRole).toString();
-
-        // XML wallpaper
-        if (QUrl url(packageName); url.scheme() == QStringLiteral("image") && url.host() == QStringLiteral("gnome-wp-list")) {
-            const QStringList paths = XmlFinder::convertToPaths(url);
-
-            for (const QString &p : paths) {
-                m_dirWatch.removeFile(p);
-            }
-
-            continue;
-        }
-
-        const QFileInfo info(packageName);
-
-        if (info.isFile()) {
-            m_dirWatch.removeFile(packageName);
-        } else if (info.isDir()) {
-            m_dirWatch.removeDir(packageName);
-        }
-    }
-}
-
-void ImageProxyModel::slotSourceModelReset()
-{
-    AbstractImageListModel *model = qobject_cast<AbstractImageListModel *>(this->sender());
-
-    if (!model) {
-        return;
-    }
-
-    // Add all items to KDirWatch
-    for (int i = 0; i < model->rowCount(); i++) {
-        const QString packageName = model->index(i, 0).data(ImageRoles::PackageNameRole).toString();
-
-        // XML wallpaper
-        if (QUrl url(packageName); url.scheme() == QStringLiteral("image") && url.host() == QStringLiteral("gnome-wp-list")) {
-            const QStringList paths = XmlFinder::convertToPaths(url);
-
-            for (const QString &p : paths) {
-                m_dirWatch.addFile(p);
-            }
-
-            continue;
-        }
-
-        const QFileInfo info(packageName);
-
-        if (info.isFile()) {
-            m_dirWatch.addFile(packageName);
-        } else if (info.isDir()) {
-            m_dirWatch.addDir(packageName);
-        }
-    }
-}
-
-void ImageProxyModel::slotDirWatchCreated(const QString &_path)
-{
-    QString path = _path;
-
-    if (int idx = path.indexOf(QLatin1String("contents/images/")); idx > 0 && !path.startsWith(QStringLiteral("image://"))) {
-        path = path.mid(0, idx);
-    }
-
-    addBackground(path);
+    ++m_loaded;
+    Q_EMIT loadingChanged();
 }
 
-void ImageProxyModel::slotDirWatchDeleted(const QString &path)
+void ImageProxyModel::slotCatalogChangesFound()
 {
-    removeBackground(path);
+    m_pendingAddition.erase(std::remove_if(m_pendingAddition.begin(),
+                                           m_pendingAddition.end(),
+                                           [this](const QString &path) {
+                                               return indexOf(path) < 0;
+                                           }),
+                            m_pendingAddition.end());
 }
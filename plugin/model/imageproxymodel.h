@@ -10,8 +10,6 @@
 #include <QConcatenateTablesProxyModel>
 #include <QSize>
 
-#include <KDirWatch>
-
 #include "imageroles.h"
 
 class AbstractImageListModel;
@@ -20,7 +18,14 @@ class PackageListModel;
 class XmlImageListModel;
 
 /**
- * A proxy model that aggregates data from ImageListModel and PackageListModel.
+ * A proxy model that aggregates data from ImageListModel, PackageListModel
+ * and XmlImageListModel.
+ *
+ * The source models are attached in a fixed order when the proxy is created,
+ * so the rows of each model show up as soon as its folders are loaded.
+ *
+ * The folders are shared with the other models through WallpaperCatalog, the
+ * wallpapers added or removed by the user only belong to this model.
  */
 class ImageProxyModel : public QConcatenateTablesProxyModel, public ImageRoles
 {
@@ -28,6 +33,10 @@ class ImageProxyModel : public QConcatenateTablesProxyModel, public ImageRoles
 
     Q_PROPERTY(int count READ count NOTIFY countChanged)
     Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+    /**
+     * Fraction of source models that have finished loading, from 0 to 1.
+     */
+    Q_PROPERTY(qreal loadingProgress READ loadingProgress NOTIFY loadingChanged)
 
 public:
     explicit ImageProxyModel(const QStringList &customPaths, const QSize &targetSize, QObject *parent);
@@ -38,8 +47,25 @@ public:
     Q_INVOKABLE int indexOf(const QString &packagePath) const;
 
     bool loading() const;
+    qreal loadingProgress() const;
 
     Q_INVOKABLE void reload();
+
+    /**
+     * Adds or removes folders after the model is created. Only the folders
+     * not covered by the other folders are scanned, and removing a folder
+     * does not scan anything.
+     */
+    void addRoots(const QStringList &roots);
+    void removeRoots(const QStringList &roots);
+    QStringList roots() const;
+
+    /**
+     * @return @p paths without the entries that are inside another folder
+     *         in @p paths
+     */
+    static QStringList minimalRoots(const QStringList &paths);
+    static QString normalizedRoot(const QString &path);
     Q_INVOKABLE QStringList addBackground(const QString &_path);
     void removeBackground(const QString &packagePath);
 
@@ -57,29 +83,23 @@ private Q_SLOTS:
     void slotHandleLoaded(AbstractImageListModel *model);
 
     /**
-     * Slots to handle item changes in source models.
+     * Drops the pending additions deleted from the disk
      */
-    void slotSourceModelAboutToBeReset();
-    void slotSourceModelReset();
-
-    /**
-     * Slots to handle file change signals from KDirWatch
-     */
-    void slotDirWatchCreated(const QString &path);
-    void slotDirWatchDeleted(const QString &path);
+    void slotCatalogChangesFound();
 
 private:
     ImageListModel *m_imageModel;
     PackageListModel *m_packageModel;
     XmlImageListModel *m_xmlModel;
 
-    KDirWatch m_dirWatch;
-
     int m_loaded = 0;
 
+    QStringList m_roots;
+
     QStringList m_pendingAddition;
 
     friend class ImageProxyModelTest;
+    friend class WallpaperCatalogTest;
 };
 
 #endif // IMAGEPROXYMODEL_H
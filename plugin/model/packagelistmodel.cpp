@@ -10,18 +10,14 @@
 #include <QDir>
 #include <QPixmap>
 #include <QStandardPaths>
-#include <QThreadPool>
+#include <QUrl>
 
-#include <KAboutData>
-#include <KPackage/PackageLoader>
-
-#include "../finder/packagefinder.h"
-#include "../finder/suffixcheck.h"
+#include "catalogroot.h"
 
 PackageListModel::PackageListModel(const QSize &targetSize, QObject *parent)
     : AbstractImageListModel(targetSize, parent)
 {
-    qRegisterMetaType<QList<KPackage::Package>>();
+    qRegisterMetaType<QList<WallpaperPackage>>();
 }
 
 int PackageListModel::rowCount(const QModelIndex &parent) const
@@ -35,67 +31,51 @@ QVariant PackageListModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    const KPackage::Package &b = m_packages.at(index.row());
-
-    if (!b.isValid()) {
-        Q_UNREACHABLE(); // Should be already filtered out by the finder
-    }
+    const WallpaperPackage &b = m_packages.at(index.row());
 
     switch (role) {
     case Qt::DisplayRole:
-        return PackageFinder::packageDisplayName(b);
+        return b.name;
 
     case ScreenshotRole: {
-        const QString path = b.filePath("preferred");
-
-        QPixmap *cachedPreview = m_imageCache.object(path);
+        QPixmap *cachedPreview = m_imageCache.object(b.preferred);
 
         if (cachedPreview) {
             return *cachedPreview;
         }
 
-        asyncGetPreview(path, QPersistentModelIndex(index));
+        asyncGetPreview(b.preferred, QPersistentModelIndex(index));
 
         return QVariant();
     }
 
-    case AuthorRole: {
-        if (!b.metadata().authors().empty()) {
-            return b.metadata().authors().at(0).name();
-        }
-
-        return QString();
-    }
+    case AuthorRole:
+        return b.author;
 
     case ResolutionRole: {
-        const QString path = b.filePath("preferred");
-
-        QSize *size = m_imageSizeCache.object(path);
+        QSize *size = m_imageSizeCache.object(b.preferred);
 
         if (size && size->isValid()) {
             return QStringLiteral("%1x%2").arg(size->width()).arg(size->height());
         }
 
-        asyncGetImageSize(path, QPersistentModelIndex(index));
+        asyncGetImageSize(b.preferred, QPersistentModelIndex(index));
 
         return QString();
     }
 
     case PathRole:
-        return QUrl::fromLocalFile(b.filePath("preferred"));
+        return QUrl::fromLocalFile(b.preferred);
 
     case PackageNameRole:
-        return b.path();
+        return b.path;
 
-    case RemovableRole: {
-        const QString path = b.path();
-
-        return path.startsWith(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/wallpapers/"))
-            || m_removableWallpapers.contains(path);
-    }
+    case RemovableRole:
+        return b.path.startsWith(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/wallpapers/"))
+            || m_removableWallpapers.contains(b.path);
 
     case PendingDeletionRole:
-        return m_pendingDeletion.value(b.path(), false);
+        return m_pendingDeletion.value(b.path, false);
     }
     Q_UNREACHABLE();
 }
@@ -107,8 +87,7 @@ bool PackageListModel::setData(const QModelIndex &index, const QVariant &value,
     }
 
     if (role == PendingDeletionRole) {
-        const KPackage::Package &b = m_packages.at(index.row());
-        m_pendingDeletion[b.path()] = value.toBool();
+        m_pendingDeletion[m_packages.at(index.row()).path] = value.toBool();
 
         Q_EMIT dataChanged(index, index, {PendingDeletionRole});
         return true;
@@ -125,8 +104,8 @@ int PackageListModel::indexOf(const QString &_path) const
         path.remove(0, 7);
     }
 
-    const auto it = std::find_if(m_packages.cbegin(), m_packages.cend(), [&path](const KPackage::Package &p) {
-        return path == p.path();
+    const auto it = std::find_if(m_packages.cbegin(), m_packages.cend(), [&path](const WallpaperPackage &p) {
+        return path == p.path;
     });
 
     if (it == m_packages.cend()) {
@@ -136,20 +115,33 @@ int PackageListModel::indexOf(const QString &_path) const
     return std::distance(m_packages.cbegin(), it);
 }
 
-void PackageListModel::load(const QStringList &customPaths)
+void PackageListModel::mergeRoots()
 {
-    if (m_loading || customPaths.empty()) {
-        return;
+    QList<WallpaperPackage> rows = m_added;
+
+    for (const CatalogRoot *root : std::as_const(m_roots)) {
+        rows += root->packages();
     }
 
-    m_customPaths = customPaths;
-    m_customPaths.removeDuplicates();
+    const auto key = [](const WallpaperPackage &package) {
+        return package.path;
+    };
 
-    PackageFinder *finder = new PackageFinder(m_customPaths, m_targetSize);
-    connect(finder, &PackageFinder::packageFound, this, &PackageListModel::slotHandlePackageFound);
-    QThreadPool::globalInstance()->start(finder);
+    QList<WallpaperPackage> incoming = filterRemoved(rows, key);
+
+    // The folders are shared by all sizes
+    for (WallpaperPackage &package : incoming) {
+        PackageFinder::findPreferredImageInPackage(package, m_targetSize);
+    }
 
-    m_loading = true;
+    // The preferred image can change with the target size
+    applyDiff(
+        m_packages,
+        incoming,
+        key,
+        [](const WallpaperPackage &a, const WallpaperPackage &b) {
+            return a.preferred == b.preferred;
+        });
 }
 
 QStringList PackageListModel::addBackground(const QString &path)
@@ -158,33 +150,24 @@ QStringList PackageListModel::addBackground(const QString &path)
         return {};
     }
 
-    KPackage::Package package = KPackage::PackageLoader::self()->loadPackage(QStringLiteral("Wallpaper/Images"));
-    package.setPath(path);
-
-    if (!package.isValid() || !package.metadata().isValid()) {
-        return {};
-    }
-
-    // Check if there are any available images.
-    QDir imageDir(package.filePath("images"));
-    imageDir.setFilter(QDir::Files | QDir::Readable);
-    imageDir.setNameFilters(suffixes());
+    const WallpaperPackage package = PackageFinder::parsePackage(path, m_targetSize);
 
-    if (imageDir.entryInfoList().empty()) {
-        // This is an empty package. Skip it.
+    if (package.path.isEmpty()) {
         return {};
     }
 
-    PackageFinder::findPreferredImageInPackage(package, m_targetSize);
-
     beginInsertRows(QModelIndex(), 0, 0);
 
-    m_removableWallpapers.prepend(package.path());
+    m_removableWallpapers.prepend(package.path);
     m_packages.prepend(package);
 
     endInsertRows();
 
-    return {package.path()};
+    m_added.prepend(package);
+    m_removed.remove(package.path);
+    watchAddedWallpaper(package.path);
+
+    return {package.path};
 }
 
 QStringList PackageListModel::removeBackground(const QString &_path)
@@ -205,9 +188,11 @@ QStringList PackageListModel::removeBackground(const QString &_path)
 
     beginRemoveRows(QModelIndex(), idx, idx);
 
-    m_pendingDeletion.remove(m_packages.at(idx).path());
-    m_removableWallpapers.removeOne(m_packages.at(idx).path());
-    results.append(m_packages.takeAt(idx).path());
+    m_pendingDeletion.remove(m_packages.at(idx).path);
+    m_removableWallpapers.removeOne(m_packages.at(idx).path);
+    removeAdded(m_packages.at(idx).path);
+    markRemoved(m_packages.at(idx).path);
+    results.append(m_packages.takeAt(idx).path);
 
     // Uninstall local package
     if (path.startsWith(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/wallpapers/"))) {
@@ -223,17 +208,62 @@ QStringList PackageListModel::removeBackground(const QString &_path)
     return results;
 }
 
-void PackageListModel::slotHandlePackageFound(const QList<KPackage::Package> &packages)
+QStringList PackageListModel::removeBackgrounds(const QStringList &paths)
 {
-    beginResetModel();
+    QSet<QString> pathSet;
 
-    m_packages = packages;
+    for (const QString &path : paths) {
+        pathSet.insert(path.endsWith(QDir::separator()) ? path : path + QDir::separator());
+    }
 
-    m_imageCache.clear();
-    m_imageSizeCache.clear();
+    QList<WallpaperPackage> remaining;
+    QStringList results;
 
-    endResetModel();
+    for (const WallpaperPackage &package : std::as_const(m_packages)) {
+        if (pathSet.contains(package.path)) {
+            results.append(package.path);
+        } else {
+            remaining.append(package);
+        }
+    }
+
+    if (results.empty()) {
+        return results;
+    }
 
-    m_loading = false;
-    Q_EMIT loaded(this);
+    const QSet<QString> resultSet(results.cbegin(), results.cend());
+
+    for (const QString &path : std::as_const(results)) {
+        removeAdded(path);
+        markRemoved(path);
+    }
+
+    m_removableWallpapers.erase(std::remove_if(m_removableWallpapers.begin(),
+                                               m_removableWallpapers.end(),
+                                               [&resultSet](const QString &path) {
+                                                   return resultSet.contains(path);
+                                               }),
+                                m_removableWallpapers.end());
+
+    applyDiff(
+        m_packages,
+        remaining,
+        [](const WallpaperPackage &package) {
+            return package.path;
+        },
+        [](const WallpaperPackage &, const WallpaperPackage &) {
+            return true;
+        });
+
+    return results;
+}
+
+void PackageListModel::removeAdded(const QString &path)
+{
+    m_added.erase(std::remove_if(m_added.begin(),
+                                 m_added.end(),
+                                 [&path](const WallpaperPackage &package) {
+                                     return package.path == path;
+                                 }),
+                  m_added.end());
 }
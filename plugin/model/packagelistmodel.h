@@ -10,7 +10,7 @@
 
 #include "abstractimagelistmodel.h"
 
-#include <KPackage/Package>
+#include "../finder/packagefinder.h"
 
 /**
  * List KPackage wallpapers, usually in a folder.
@@ -31,17 +31,20 @@ public:
      */
     int indexOf(const QString &path) const override;
 
-    void load(const QStringList &customPaths = {}) override;
-
 public Q_SLOTS:
     QStringList addBackground(const QString &path) override;
     QStringList removeBackground(const QString &path) override;
+    QStringList removeBackgrounds(const QStringList &paths) override;
 
-private Q_SLOTS:
-    void slotHandlePackageFound(const QList<KPackage::Package> &packages);
+protected:
+    void mergeRoots() override;
 
 private:
-    QList<KPackage::Package> m_packages;
+    void removeAdded(const QString &path);
+
+    QList<WallpaperPackage> m_packages;
+    // Added by the user, newest first
+    QList<WallpaperPackage> m_added;
 
     friend class PackageListModelTest;
 };
@@ -0,0 +1,169 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "wallpapercatalog.h"
+
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QUrl>
+
+#include <algorithm>
+
+#include "../finder/filechangefinder.h"
+#include "../finder/xmlfinder.h"
+#include "abstractimagelistmodel.h"
+#include "catalogroot.h"
+#include "imageproxymodel.h"
+
+WallpaperCatalog *WallpaperCatalog::self()
+{
+    static WallpaperCatalog s_self;
+    return &s_self;
+}
+
+WallpaperCatalog::WallpaperCatalog(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<WallpaperChanges>();
+
+    connect(&m_dirWatch, &DirectoryWatcher::changed, this, &WallpaperCatalog::slotDirWatchChanged);
+}
+
+WallpaperCatalog::~WallpaperCatalog()
+{
+    // The folders unregister their files from m_dirWatch, so they go first,
+    // including the released ones that are not deleted yet
+    qDeleteAll(findChildren<CatalogRoot *>(QString(), Qt::FindDirectChildrenOnly));
+}
+
+CatalogRoot *WallpaperCatalog::acquire(const QString &_path)
+{
+    const QString path = ImageProxyModel::normalizedRoot(_path);
+
+    Entry &entry = m_roots[path];
+    entry.refCount++;
+
+    if (entry.root) {
+        return entry.root;
+    }
+
+    entry.root = new CatalogRoot(path, &m_dirWatch, this);
+
+    const bool isDir = QFileInfo(path).isDir();
+
+    if (isDir) {
+        m_dirWatch.addRoot(path);
+    }
+
+    // A folder inside a loaded folder is already known
+    const auto parentIt = std::find_if(m_roots.cbegin(), m_roots.cend(), [&path](const Entry &other) {
+        return other.root && other.root->isLoaded() && other.root->path() != path && AbstractImageListModel::isInRoots(path, {other.root->path()});
+    });
+
+    if (isDir && parentIt != m_roots.cend()) {
+        entry.root->copyFrom(*parentIt->root);
+    } else {
+        entry.root->scan();
+    }
+
+    return entry.root;
+}
+
+void WallpaperCatalog::release(CatalogRoot *root)
+{
+    if (!root) {
+        return;
+    }
+
+    const auto it = m_roots.find(root->path());
+
+    if (it == m_roots.end() || it->root != root || --it->refCount > 0) {
+        return;
+    }
+
+    m_roots.erase(it);
+    m_dirWatch.removeRoot(root->path());
+
+    // The folder may be releasing itself from one of its signals
+    root->deleteLater();
+}
+
+int WallpaperCatalog::count() const
+{
+    return m_roots.size();
+}
+
+DirectoryWatcher *WallpaperCatalog::directoryWatcher()
+{
+    return &m_dirWatch;
+}
+
+QStringList WallpaperCatalog::watchedPaths(const QString &packageName)
+{
+    // XML wallpaper
+    if (QUrl url(packageName); url.scheme() == QStringLiteral("image") && url.host() == QStringLiteral("gnome-wp-list")) {
+        return XmlFinder::convertToPaths(url);
+    }
+
+    return {packageName};
+}
+
+void WallpaperCatalog::slotDirWatchChanged(const QStringList &created, const QStringList &deleted)
+{
+    if (m_validatingChanges) {
+        // Later events win over earlier ones in the queue
+        for (const QString &path : created) {
+            m_queuedDeleted.remove(path);
+            m_queuedCreated.insert(path);
+        }
+        for (const QString &path : deleted) {
+            m_queuedCreated.remove(path);
+            m_queuedDeleted.insert(path);
+        }
+        return;
+    }
+
+    validateChanges(created, deleted);
+}
+
+void WallpaperCatalog::validateChanges(const QStringList &created, const QStringList &deleted)
+{
+    m_validatingChanges = true;
+
+    // The preferred images are picked by each model
+    auto finder = new FileChangeFinder(created, deleted, QSize());
+    connect(finder, &FileChangeFinder::changesFound, this, &WallpaperCatalog::slotHandleChangesFound);
+    QThreadPool::globalInstance()->start(finder);
+}
+
+void WallpaperCatalog::slotHandleChangesFound(const WallpaperChanges &changes)
+{
+    // Models may release folders while they update
+    QList<CatalogRoot *> roots;
+    roots.reserve(m_roots.size());
+
+    for (const Entry &entry : std::as_const(m_roots)) {
+        roots.append(entry.root);
+    }
+
+    // Each model removes or inserts the whole batch at once
+    for (CatalogRoot *root : std::as_const(roots)) {
+        root->applyChanges(changes);
+    }
+
+    Q_EMIT changesFound(changes);
+
+    m_validatingChanges = false;
+
+    if (!m_queuedCreated.empty() || !m_queuedDeleted.empty()) {
+        const QStringList created = m_queuedCreated.values();
+        const QStringList deleted = m_queuedDeleted.values();
+        m_queuedCreated.clear();
+        m_queuedDeleted.clear();
+
+        validateChanges(created, deleted);
+    }
+}
@@ -0,0 +1,96 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef WALLPAPERCATALOG_H
+#define WALLPAPERCATALOG_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+#include "directorywatcher.h"
+
+class CatalogRoot;
+struct WallpaperChanges;
+
+/**
+ * A process-wide catalog that shares the wallpapers of each folder between
+ * all models, so every screen and the config dialog do not scan, watch and
+ * parse the same folders again.
+ *
+ * A folder is shared regardless of the target size, the models pick the
+ * preferred images for their own size. It is deleted when the last model
+ * releases it.
+ */
+class WallpaperCatalog : public QObject
+{
+    Q_OBJECT
+
+public:
+    static WallpaperCatalog *self();
+    ~WallpaperCatalog() override;
+
+    /**
+     * @return the wallpapers of @p path, which may be already loaded. A
+     *         folder inside a loaded folder is not scanned again.
+     */
+    CatalogRoot *acquire(const QString &path);
+    void release(CatalogRoot *root);
+
+    /**
+     * @return the number of shared folders
+     */
+    int count() const;
+
+    /**
+     * Watches the shared folders and the wallpapers added by the user
+     */
+    DirectoryWatcher *directoryWatcher();
+
+    /**
+     * @return files or folders that should be monitored for the package
+     */
+    static QStringList watchedPaths(const QString &packageName);
+
+Q_SIGNALS:
+    /**
+     * Emitted after the folders have applied a batch of file changes, so
+     * models can drop deleted wallpapers that are not in any folder
+     */
+    void changesFound(const WallpaperChanges &changes);
+
+private Q_SLOTS:
+    /**
+     * Slots to handle file change batches from DirectoryWatcher.
+     * Created files are validated by FileChangeFinder off the GUI thread.
+     */
+    void slotDirWatchChanged(const QStringList &created, const QStringList &deleted);
+    void slotHandleChangesFound(const WallpaperChanges &changes);
+
+private:
+    explicit WallpaperCatalog(QObject *parent = nullptr);
+
+    void validateChanges(const QStringList &created, const QStringList &deleted);
+
+    struct Entry {
+        CatalogRoot *root = nullptr;
+        int refCount = 0;
+    };
+
+    QHash<QString, Entry> m_roots;
+
+    DirectoryWatcher m_dirWatch;
+
+    // Only one batch is validated at a time, so changes are applied in order
+    bool m_validatingChanges = false;
+    QSet<QString> m_queuedCreated;
+    QSet<QString> m_queuedDeleted;
+
+    friend class WallpaperCatalogTest;
+};
+
+#endif // WALLPAPERCATALOG_H
@@ -10,6 +10,7 @@
 #include <QThreadPool>
 
 #include "../finder/xmlfinder.h"
+#include "catalogroot.h"
 #include "xmlpreviewgenerator.h"
 
 XmlImageListModel::XmlImageListModel(const QSize &targetSize, QObject *parent)
@@ -110,20 +111,33 @@ int XmlImageListModel::indexOf(const QString &path) const
     return std::distance(m_data.cbegin(), it);
 }
 
-void XmlImageListModel::load(const QStringList &customPaths)
+void XmlImageListModel::mergeRoots()
 {
-    if (m_loading || customPaths.empty()) {
-        return;
+    QList<WallpaperItem> rows = m_added;
+
+    for (const CatalogRoot *root : std::as_const(m_roots)) {
+        rows += root->xmlItems();
     }
 
-    m_customPaths = customPaths;
-    m_customPaths.removeDuplicates();
+    const auto key = [](const WallpaperItem &item) {
+        return item.path.toString();
+    };
 
-    XmlFinder *finder = new XmlFinder(m_customPaths, m_targetSize);
-    connect(finder, &XmlFinder::xmlFound, this, &XmlImageListModel::slotXmlFound);
-    QThreadPool::globalInstance()->start(finder);
+    QList<WallpaperItem> incoming = filterRemoved(rows, key);
 
-    m_loading = true;
+    // The folders are shared by all sizes
+    for (WallpaperItem &item : incoming) {
+        XmlFinder::findPreferredImages(item.slideshow, m_targetSize);
+    }
+
+    // Slideshow frames can change with the target size
+    applyDiff(
+        m_data,
+        incoming,
+        key,
+        [this](const WallpaperItem &a, const WallpaperItem &b) {
+            return getRealPath(a) == getRealPath(b);
+        });
 }
 
 QStringList XmlImageListModel::addBackground(const QString &path)
@@ -160,6 +174,12 @@ QStringList XmlImageListModel::addBackground(const QString &path)
 
     endInsertRows();
 
+    for (const auto &p : std::as_const(pendingList)) {
+        m_added.prepend(p);
+        m_removed.remove(p.path.toString());
+        watchAddedWallpaper(p.path.toString());
+    }
+
     return results;
 }
 
@@ -206,6 +226,8 @@ QStringList XmlImageListModel::removeBackground(const QString &path)
 
     m_pendingDeletion.remove(p.path.toString());
     m_removableWallpapers.removeOne(p.path.toString());
+    removeAdded(p.path.toString());
+    markRemoved(p.path.toString());
     results.append(p.path.toString());
 
     endRemoveRows();
@@ -213,16 +235,50 @@ QStringList XmlImageListModel::removeBackground(const QString &path)
     return results;
 }
 
-void XmlImageListModel::slotXmlFound(const QList<WallpaperItem> &packages)
+QStringList XmlImageListModel::removeBackgrounds(const QStringList &paths)
 {
-    beginResetModel();
+    const QSet<QString> pathSet(paths.cbegin(), paths.cend());
+    QList<WallpaperItem> remaining;
+    QStringList results;
 
-    m_data = packages;
+    // Removing the XML file or the image removes the wallpaper, too.
+    for (const WallpaperItem &item : std::as_const(m_data)) {
+        if (pathSet.contains(item.path.toString()) || pathSet.contains(item._root) || pathSet.contains(item.filename)) {
+            results.append(item.path.toString());
+        } else {
+            remaining.append(item);
+        }
+    }
+
+    if (results.empty()) {
+        return results;
+    }
+
+    const QSet<QString> resultSet(results.cbegin(), results.cend());
+
+    for (const QString &path : std::as_const(results)) {
+        removeAdded(path);
+        markRemoved(path);
+    }
 
-    endResetModel();
+    m_removableWallpapers.erase(std::remove_if(m_removableWallpapers.begin(),
+                                               m_removableWallpapers.end(),
+                                               [&resultSet](const QString &path) {
+                                                   return resultSet.contains(path);
+                                               }),
+                                m_removableWallpapers.end());
+
+    applyDiff(
+        m_data,
+        remaining,
+        [](const WallpaperItem &item) {
+            return item.path.toString();
+        },
+        [](const WallpaperItem &, const WallpaperItem &) {
+            return true;
+        });
 
-    m_loading = false;
-    Q_EMIT loaded(this);
+    return results;
 }
 
 void XmlImageListModel::slotXmlFinderGotPreview(const WallpaperItem &item, const QPixmap &_preview)
@@ -261,7 +317,7 @@ void XmlImageListModel::asyncGetXmlPreview(const WallpaperItem &item, const QPer
         return;
     }
 
-    XmlPreviewGenerator *finder = new XmlPreviewGenerator(item, m_screenshotSize);
+    XmlPreviewGenerator *finder = new XmlPreviewGenerator(item, m_targetSize, m_screenshotSize);
     connect(finder, &XmlPreviewGenerator::gotPreview, this, &XmlImageListModel::slotXmlFinderGotPreview);
     connect(finder, &XmlPreviewGenerator::failed, this, &XmlImageListModel::slotXmlFinderFailed);
     QThreadPool::globalInstance()->start(finder);
@@ -283,3 +339,13 @@ QString XmlImageListModel::getRealPath(const WallpaperItem &item) const
 
     return path;
 }
+
+void XmlImageListModel::removeAdded(const QString &path)
+{
+    m_added.erase(std::remove_if(m_added.begin(),
+                                 m_added.end(),
+                                 [&path](const WallpaperItem &item) {
+                                     return item.path.toString() == path;
+                                 }),
+                  m_added.end());
+}
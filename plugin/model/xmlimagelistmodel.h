@@ -30,8 +30,6 @@ public:
      */
     int indexOf(const QString &path) const override;
 
-    void load(const QStringList &customPaths = {}) override;
-
 public Q_SLOTS:
     /**
      * @path XML file path
@@ -42,9 +40,15 @@ public Q_SLOTS:
      * @return a list that contains the XML file and the image file
      */
     QStringList removeBackground(const QString &path) override;
+    /**
+     * @paths URL strings, XML files or image files
+     */
+    QStringList removeBackgrounds(const QStringList &paths) override;
+
+protected:
+    void mergeRoots() override;
 
 private Q_SLOTS:
-    void slotXmlFound(const QList<WallpaperItem> &packages);
     void slotXmlFinderGotPreview(const WallpaperItem &item, const QPixmap &preview);
     void slotXmlFinderFailed(const WallpaperItem &item);
 
@@ -52,8 +56,11 @@ private:
     void asyncGetXmlPreview(const WallpaperItem &item, const QPersistentModelIndex &index) const;
 
     QString getRealPath(const WallpaperItem &item) const;
+    void removeAdded(const QString &path);
 
     QList<WallpaperItem> m_data;
+    // Added by the user, newest first
+    QList<WallpaperItem> m_added;
 
     friend class XmlImageListModelTest;
 };
@@ -6,6 +6,7 @@
 
 #include "xmlpreviewgenerator.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QEventLoop>
@@ -14,9 +15,12 @@
 
 #include <KIO/PreviewJob>
 
-XmlPreviewGenerator::XmlPreviewGenerator(const WallpaperItem &item, const QSize &size, QObject *parent)
+#include "../slideshowtimeline.h"
+
+XmlPreviewGenerator::XmlPreviewGenerator(const WallpaperItem &item, const QSize &targetSize, const QSize &size, QObject *parent)
     : QObject(parent)
     , m_item(item)
+    , m_targetSize(targetSize)
     , m_screenshotSize(size)
 {
 }
@@ -74,25 +78,37 @@ QPixmap XmlPreviewGenerator::generateSlideshowPreview()
     int staticCount = 0;
 
     std::vector<QImage> list;
-    list.reserve(std::max<int>(m_item.slideshow.data.size(), 2));
+    list.reserve(std::clamp<int>(m_item.slideshow.data.size(), 2, 8));
 
     if (!m_item.slideshow.data.empty()) {
-        for (const auto &item : std::as_const(m_item.slideshow.data)) {
-            if (item.dataType == 0) {
-                const QImage image(item.file);
+        const auto timeline = SlideshowTimeline::load(m_item.filename, m_targetSize);
+        QStringList files = timeline ? timeline->staticFiles() : QStringList();
+
+        // A time-lapse can have thousands of images, a few of them are enough for a preview
+        if (files.size() > 8) {
+            QStringList sampled;
+
+            for (int i = 0; i < 8; i++) {
+                sampled.append(files.at(i * files.size() / 8));
+            }
 
-                if (image.isNull()) {
-                    continue;
-                }
+            files = sampled;
+        }
+
+        for (const QString &file : std::as_const(files)) {
+            const QImage image(file);
 
-                if (m_screenshotSize.width() > m_screenshotSize.height()) {
-                    list.emplace_back(image.scaledToHeight(m_screenshotSize.height(), Qt::SmoothTransformation));
-                } else {
-                    list.emplace_back(image.scaledToWidth(m_screenshotSize.width(), Qt::SmoothTransformation));
-                }
+            if (image.isNull()) {
+                continue;
+            }
 
-                staticCount += 1;
+            if (m_screenshotSize.width() > m_screenshotSize.height()) {
+                list.emplace_back(image.scaledToHeight(m_screenshotSize.height(), Qt::SmoothTransformation));
+            } else {
+                list.emplace_back(image.scaledToWidth(m_screenshotSize.width(), Qt::SmoothTransformation));
             }
+
+            staticCount += 1;
         }
     } else {
         if (m_screenshotSize.width() > m_screenshotSize.height()) {
@@ -12,14 +12,21 @@
 #include "../finder/xmlfinder.h"
 
 /**
- * A runnable that generates image previews for XML wallpapers
+ * A runnable that generates image previews for XML wallpapers.
+ *
+ * Slideshows are read through SlideshowTimeline::load(), so the preview
+ * shares the compiled timeline of the wallpaper shown for the same size.
  */
 class XmlPreviewGenerator : public QObject, public QRunnable
 {
     Q_OBJECT
 
 public:
-    explicit XmlPreviewGenerator(const WallpaperItem &item, const QSize &size, QObject *parent = nullptr);
+    /**
+     * @param targetSize the size the images of a slideshow are picked for
+     * @param size the size of the preview
+     */
+    explicit XmlPreviewGenerator(const WallpaperItem &item, const QSize &targetSize, const QSize &size, QObject *parent = nullptr);
 
     void run() override;
 
@@ -32,6 +39,7 @@ private:
     QPixmap generateSlideshowPreview();
 
     WallpaperItem m_item;
+    QSize m_targetSize;
     QSize m_screenshotSize;
 };
 
@@ -0,0 +1,68 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "asyncimageresponse.h"
+
+#include <QRunnable>
+
+class AsyncImageResponseRunnable : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    explicit AsyncImageResponseRunnable(const AsyncImageResponse::Decoder &decoder, const std::shared_ptr<std::atomic_bool> &canceled);
+
+    void run() override;
+
+Q_SIGNALS:
+    void done(const QImage &image);
+
+private:
+    AsyncImageResponse::Decoder m_decoder;
+    std::shared_ptr<std::atomic_bool> m_canceled;
+};
+
+AsyncImageResponseRunnable::AsyncImageResponseRunnable(const AsyncImageResponse::Decoder &decoder, const std::shared_ptr<std::atomic_bool> &canceled)
+    : m_decoder(decoder)
+    , m_canceled(canceled)
+{
+}
+
+void AsyncImageResponseRunnable::run()
+{
+    // Made obsolete before it started
+    if (m_canceled->load()) {
+        Q_EMIT done(QImage());
+        return;
+    }
+
+    Q_EMIT done(m_decoder(m_canceled.get()));
+}
+
+AsyncImageResponse::AsyncImageResponse(const Decoder &decoder, QThreadPool *pool)
+{
+    auto runnable = new AsyncImageResponseRunnable(decoder, m_canceled);
+    connect(runnable, &AsyncImageResponseRunnable::done, this, &AsyncImageResponse::slotHandleDone);
+    pool->start(runnable);
+}
+
+void AsyncImageResponse::slotHandleDone(const QImage &image)
+{
+    m_image = image;
+    Q_EMIT finished();
+}
+
+QQuickTextureFactory *AsyncImageResponse::textureFactory() const
+{
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+void AsyncImageResponse::cancel()
+{
+    m_canceled->store(true);
+}
+
+#include "asyncimageresponse.moc"
@@ -0,0 +1,49 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef ASYNCIMAGERESPONSE_H
+#define ASYNCIMAGERESPONSE_H
+
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/**
+ * An image response that decodes the image in a thread pool, shared by the
+ * image providers.
+ */
+class AsyncImageResponse : public QQuickImageResponse
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Called in the thread pool. The flag is set when the response is
+     * canceled, see ImageCache::readImage().
+     */
+    using Decoder = std::function<QImage(const std::atomic_bool *canceled)>;
+
+    explicit AsyncImageResponse(const Decoder &decoder, QThreadPool *pool);
+
+    QQuickTextureFactory *textureFactory() const override;
+
+    /**
+     * Stops the decoder at its next checkpoint. finished() is still emitted.
+     */
+    void cancel() override;
+
+private Q_SLOTS:
+    void slotHandleDone(const QImage &image);
+
+private:
+    QImage m_image;
+    std::shared_ptr<std::atomic_bool> m_canceled = std::make_shared<std::atomic_bool>(false);
+};
+
+#endif // ASYNCIMAGERESPONSE_H
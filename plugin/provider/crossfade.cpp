@@ -0,0 +1,252 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "crossfade.h"
+
+#include <QPainter>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "crossfadekernels.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CROSSFADE_HAVE_AVX2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Two channels at a time
+ */
+static void blendLineScalar(quint32 *dst, const quint32 *from, const quint32 *to, int count, int weight)
+{
+    const quint32 inverse = 256 - weight;
+
+    for (int i = 0; i < count; i++) {
+        const quint32 a = from[i];
+        const quint32 b = to[i];
+
+        const quint32 rb = (((a & 0xff00ff) * inverse + (b & 0xff00ff) * weight) >> 8) & 0xff00ff;
+        const quint32 ag = (((a >> 8) & 0xff00ff) * inverse + ((b >> 8) & 0xff00ff) * weight) & 0xff00ff00;
+
+        dst[i] = rb | ag;
+    }
+}
+
+#if defined(__SSE2__)
+static void blendLineSse2(quint32 *dst, const quint32 *from, const quint32 *to, int count, int weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i toWeight = _mm_set1_epi16(weight);
+    const __m128i fromWeight = _mm_set1_epi16(256 - weight);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(to + i));
+
+        // At most 255 * 256, so the sums fit in 16 bits
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), fromWeight), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), toWeight));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), fromWeight), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), toWeight));
+        low = _mm_srli_epi16(low, 8);
+        high = _mm_srli_epi16(high, 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(low, high));
+    }
+
+    blendLineScalar(dst + i, from + i, to + i, count - i, weight);
+}
+#endif
+
+#if defined(CROSSFADE_HAVE_AVX2)
+__attribute__((target("avx2"))) static void blendLineAvx2(quint32 *dst, const quint32 *from, const quint32 *to, int count, int weight)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i toWeight = _mm256_set1_epi16(weight);
+    const __m256i fromWeight = _mm256_set1_epi16(256 - weight);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(from + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(to + i));
+
+        // Unpacking and packing both work within 128-bit lanes, so the order is kept
+        __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), fromWeight),
+                                       _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), toWeight));
+        __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), fromWeight),
+                                        _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), toWeight));
+        low = _mm256_srli_epi16(low, 8);
+        high = _mm256_srli_epi16(high, 8);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(low, high));
+    }
+
+    blendLineScalar(dst + i, from + i, to + i, count - i, weight);
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static void blendLineNeon(quint32 *dst, const quint32 *from, const quint32 *to, int count, int weight)
+{
+    // The weight is between 1 and 255 here, see crossFade()
+    const uint8x8_t toWeight = vdup_n_u8(weight);
+    const uint8x8_t fromWeight = vdup_n_u8(256 - weight);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t *>(from + i));
+        const uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t *>(to + i));
+
+        const uint16x8_t low = vmlal_u8(vmull_u8(vget_low_u8(a), fromWeight), vget_low_u8(b), toWeight);
+        const uint16x8_t high = vmlal_u8(vmull_u8(vget_high_u8(a), fromWeight), vget_high_u8(b), toWeight);
+
+        vst1q_u8(reinterpret_cast<uint8_t *>(dst + i), vcombine_u8(vshrn_n_u16(low, 8), vshrn_n_u16(high, 8)));
+    }
+
+    blendLineScalar(dst + i, from + i, to + i, count - i, weight);
+}
+#endif
+
+std::vector<BlendLineKernel> blendLineKernels()
+{
+    std::vector<BlendLineKernel> kernels{{"scalar", &blendLineScalar}};
+
+#if defined(__SSE2__)
+    kernels.push_back({"sse2", &blendLineSse2});
+#endif
+#if defined(CROSSFADE_HAVE_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({"avx2", &blendLineAvx2});
+    }
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    kernels.push_back({"neon", &blendLineNeon});
+#endif
+
+    return kernels;
+}
+
+static BlendLineFunction blendLineFunction()
+{
+    static const BlendLineFunction function = blendLineKernels().back().function;
+
+    return function;
+}
+
+QImage crossFade(const QImage &from, const QImage &to, int step)
+{
+    if (from.isNull() || to.isNull()) {
+        return from;
+    }
+
+    step = std::clamp(step, 0, 255);
+
+    QImage target = to;
+
+    if (target.size() != from.size()) {
+        target = target.scaled(from.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    if (from.hasAlphaChannel() || target.hasAlphaChannel()) {
+        QImage image = from.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+        painter.setOpacity(step / 255.0);
+        painter.drawImage(0, 0, target);
+        painter.end();
+
+        return image;
+    }
+
+    // The lerp works on every byte alike, so only the two formats need to match
+    const QImage::Format format =
+        from.format() == QImage::Format_RGBX8888 && target.format() == QImage::Format_RGBX8888 ? QImage::Format_RGBX8888 : QImage::Format_RGB32;
+    const QImage a = from.convertToFormat(format);
+    const QImage b = target.convertToFormat(format);
+
+    // 0 to 256, so a full step is a shift
+    const int weight = (step * 256 + 127) / 255;
+
+    if (weight == 0) {
+        return a;
+    } else if (weight == 256) {
+        return b;
+    }
+
+    QImage image(a.size(), format);
+
+    if (image.isNull()) {
+        return a;
+    }
+
+    const BlendLineFunction blendLine = blendLineFunction();
+    const int width = image.width();
+    // Taken once, scanLine() may detach and is not safe to call from several threads
+    uchar *const dstBits = image.bits();
+    const uchar *const fromBits = a.constBits();
+    const uchar *const toBits = b.constBits();
+
+    const qsizetype dstStride = image.bytesPerLine();
+    const qsizetype fromStride = a.bytesPerLine();
+    const qsizetype toStride = b.bytesPerLine();
+
+    const auto blendLines = [=](int first, int last) {
+        for (int y = first; y < last; y++) {
+            blendLine(reinterpret_cast<quint32 *>(dstBits + y * dstStride),
+                      reinterpret_cast<const quint32 *>(fromBits + y * fromStride),
+                      reinterpret_cast<const quint32 *>(toBits + y * toStride),
+                      width,
+                      weight);
+        }
+    };
+
+    // Threads only pay off for large images, e.g. 4K and above
+    const int chunkCount = image.width() * image.height() >= 2 * 1024 * 1024 ? std::clamp(QThread::idealThreadCount(), 1, 4) : 1;
+
+    if (chunkCount == 1) {
+        blendLines(0, image.height());
+        return image;
+    }
+
+    // Shared with the helpers, which may only get a thread once all chunks are taken
+    struct Chunks {
+        std::atomic_int next{0};
+        QSemaphore done;
+    };
+    const auto chunks = std::make_shared<Chunks>();
+    const int height = image.height();
+    const int rowsPerChunk = (height + chunkCount - 1) / chunkCount;
+
+    const auto blendChunks = [=] {
+        for (int chunk = chunks->next++; chunk < chunkCount; chunk = chunks->next++) {
+            blendLines(chunk * rowsPerChunk, std::min((chunk + 1) * rowsPerChunk, height));
+            chunks->done.release();
+        }
+    };
+
+    // Only idle threads help, the rest is blended here
+    for (int i = 1; i < chunkCount; i++) {
+        if (!QThreadPool::globalInstance()->tryStart(blendChunks)) {
+            break;
+        }
+    }
+
+    blendChunks();
+    chunks->done.acquire(chunkCount);
+
+    return image;
+}
@@ -0,0 +1,20 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QImage>
+
+/**
+ * Cross-fades @p from into @p to, @p step out of 255 of the way.
+ *
+ * Opaque images are blended with a fixed-point lerp, vectorized with
+ * SSE2, AVX2 or NEON where available and split over threads for large
+ * images. Images with an alpha channel go through QPainter.
+ *
+ * @p to is stretched to the size of @p from.
+ */
+QImage crossFade(const QImage &from, const QImage &to, int step);
@@ -0,0 +1,31 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <vector>
+
+/**
+ * Blends one line of opaque 32-bit pixels,
+ * dst = (from * (256 - weight) + to * weight) / 256 for every channel.
+ * @p weight is between 1 and 255.
+ */
+using BlendLineFunction = void (*)(quint32 *dst, const quint32 *from, const quint32 *to, int count, int weight);
+
+struct BlendLineKernel {
+    const char *name;
+    BlendLineFunction function;
+};
+
+/**
+ * @return the line kernels built in and supported by this CPU, the scalar
+ * one first and the one crossFade() uses last
+ *
+ * @internal Only exposed for the tests
+ */
+std::vector<BlendLineKernel> blendLineKernels();
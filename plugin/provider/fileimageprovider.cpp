@@ -0,0 +1,30 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "fileimageprovider.h"
+
+#include <QUrlQuery>
+
+#include "asyncimageresponse.h"
+#include "imagecache.h"
+
+FileImageProvider::FileImageProvider()
+{
+}
+
+QQuickImageResponse *FileImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    const QUrlQuery urlQuery(QUrl(QStringLiteral("image://file/%1").arg(id)));
+    const QString path = urlQuery.queryItemValue(QStringLiteral("path"));
+    const bool crop = ImageCache::isCropFillMode(urlQuery.queryItemValue(QStringLiteral("fillmode")).toInt());
+
+    // Read the image and resize it if the requested size is valid
+    return new AsyncImageResponse(
+        [path, requestedSize, crop](const std::atomic_bool *canceled) {
+            return ImageCache::decodeSlide(path, requestedSize, crop, canceled);
+        },
+        &m_pool);
+}
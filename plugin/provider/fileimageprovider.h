@@ -0,0 +1,28 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef FILEIMAGEPROVIDER_H
+#define FILEIMAGEPROVIDER_H
+
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
+
+/**
+ * Custom image provider for image files, which shares the decoded images
+ * through ImageCache
+ */
+class FileImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    explicit FileImageProvider();
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    QThreadPool m_pool;
+};
+
+#endif // FILEIMAGEPROVIDER_H
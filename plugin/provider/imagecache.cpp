@@ -0,0 +1,389 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "imagecache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QRunnable>
+#include <QThread>
+
+#include <algorithm>
+
+#include "finder/packagefinder.h"
+
+class PrefetchRunnable : public QRunnable
+{
+public:
+    explicit PrefetchRunnable(const QString &key, const std::function<void()> &job);
+
+    void run() override;
+
+private:
+    QString m_key;
+    std::function<void()> m_job;
+};
+
+PrefetchRunnable::PrefetchRunnable(const QString &key, const std::function<void()> &job)
+    : m_key(key)
+    , m_job(job)
+{
+}
+
+void PrefetchRunnable::run()
+{
+    // Never compete with the image that is on screen now
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+
+    m_job();
+    ImageCache::self()->finishPrefetch(m_key);
+}
+
+ImageCache::ImageCache()
+{
+    m_images.setMaxCost(128 * 1024);
+    m_pool.setMaxThreadCount(1);
+}
+
+ImageCache *ImageCache::self()
+{
+    static ImageCache cache;
+    return &cache;
+}
+
+QString ImageCache::cacheKey(const QString &file, const QSize &size, const QString &frame)
+{
+    return QStringLiteral("%1@%2x%3#%4").arg(fileKey(file), QString::number(size.width()), QString::number(size.height()), frame);
+}
+
+QString ImageCache::fileKey(const QString &file)
+{
+    const QFileInfo info(file);
+
+    return QDir::cleanPath(file) + QLatin1Char(':') + QString::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+QString ImageCache::slideKey(const QString &path, const QSize &size, bool crop)
+{
+    const QString file = slideFile(path, size);
+
+    return file.isEmpty() ? QString() : cacheKey(file, size, cropFrame(crop));
+}
+
+bool ImageCache::isCropFillMode(int fillMode)
+{
+    // Image.PreserveAspectCrop
+    return fillMode == 2;
+}
+
+QString ImageCache::cropFrame(bool crop)
+{
+    return crop ? QStringLiteral("crop") : QString();
+}
+
+QString ImageCache::slideFile(const QString &path, const QSize &size)
+{
+    if (!QFileInfo(path).isDir()) {
+        return path;
+    }
+
+    // Parsing a package lists all its images, so the choice is kept until the images change
+    const QString key = QStringLiteral("%1@%2x%3").arg(QDir::cleanPath(path), QString::number(size.width()), QString::number(size.height()));
+    const qint64 modified = QFileInfo(path + QLatin1String("/contents/images")).lastModified().toMSecsSinceEpoch();
+    ImageCache *cache = self();
+
+    {
+        std::lock_guard lock(cache->m_mutex);
+
+        if (auto it = cache->m_packageFiles.constFind(key); it != cache->m_packageFiles.cend() && it->modified == modified) {
+            return it->preferred;
+        }
+    }
+
+    const QString preferred = PackageFinder::parsePackage(path, size).preferred;
+
+    std::lock_guard lock(cache->m_mutex);
+
+    if (cache->m_packageFiles.size() >= 256) {
+        cache->m_packageFiles.clear();
+    }
+
+    cache->m_packageFiles.insert(key, {modified, preferred});
+
+    return preferred;
+}
+
+QString ImageCache::pendingKey(const QString &path, const QSize &size, bool crop)
+{
+    // Package folders come with and without a trailing separator
+    return QStringLiteral("%1@%2x%3#%4").arg(QDir::cleanPath(path), QString::number(size.width()), QString::number(size.height()), cropFrame(crop));
+}
+
+QImage ImageCache::find(const QString &key)
+{
+    std::lock_guard lock(m_mutex);
+
+    if (const auto it = m_pinned.constFind(key); it != m_pinned.cend()) {
+        return *it;
+    }
+
+    const QImage *image = m_images.object(key);
+
+    return image ? *image : QImage();
+}
+
+bool ImageCache::contains(const QString &key)
+{
+    std::lock_guard lock(m_mutex);
+
+    return m_pinned.contains(key) || m_images.contains(key);
+}
+
+void ImageCache::insert(const QString &key, const QImage &image)
+{
+    std::lock_guard lock(m_mutex);
+
+    insertLocked(key, image);
+}
+
+void ImageCache::insertLocked(const QString &key, const QImage &image)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    if (m_pinCounts.contains(key)) {
+        m_pinned.insert(key, image);
+        return;
+    }
+
+    // An image larger than the budget is not kept
+    m_images.insert(key, new QImage(image), std::max(1, int(image.sizeInBytes() / 1024)));
+}
+
+void ImageCache::clear()
+{
+    std::lock_guard lock(m_mutex);
+
+    m_images.clear();
+    m_pinned.clear();
+    m_packageFiles.clear();
+}
+
+QImage ImageCache::decode(const QString &key, const std::function<QImage()> &decoder)
+{
+    std::unique_lock lock(m_mutex);
+
+    // e.g. every screen asks for the same wallpaper at startup
+    m_decoded.wait(lock, [this, &key] {
+        return !m_decoding.contains(key);
+    });
+
+    if (const auto it = m_pinned.constFind(key); it != m_pinned.cend()) {
+        return *it;
+    }
+
+    if (const QImage *image = m_images.object(key)) {
+        return *image;
+    }
+
+    m_decoding.insert(key);
+    lock.unlock();
+
+    const QImage image = decoder();
+
+    lock.lock();
+    m_decoding.remove(key);
+    insertLocked(key, image);
+    lock.unlock();
+
+    m_decoded.notify_all();
+
+    return image;
+}
+
+void ImageCache::pin(const QString &owner, const QStringList &_keys)
+{
+    QStringList keys = _keys;
+    keys.removeAll(QString());
+    keys.removeDuplicates();
+
+    std::lock_guard lock(m_mutex);
+
+    const QStringList oldKeys = m_pinOwners.value(owner);
+
+    if (oldKeys == keys) {
+        return;
+    }
+
+    for (const QString &key : keys) {
+        if (oldKeys.contains(key) || m_pinCounts[key]++ > 0) {
+            continue;
+        }
+
+        if (QImage *image = m_images.take(key)) {
+            m_pinned.insert(key, *image);
+            delete image;
+        }
+    }
+
+    for (const QString &key : oldKeys) {
+        if (keys.contains(key) || --m_pinCounts[key] > 0) {
+            continue;
+        }
+
+        m_pinCounts.remove(key);
+        insertLocked(key, m_pinned.take(key));
+    }
+
+    if (keys.empty()) {
+        m_pinOwners.remove(owner);
+    } else {
+        m_pinOwners.insert(owner, keys);
+    }
+}
+
+void ImageCache::unpin(const QString &owner)
+{
+    pin(owner, {});
+}
+
+qint64 ImageCache::budget() const
+{
+    std::lock_guard lock(m_mutex);
+
+    return qint64(m_images.maxCost()) * 1024;
+}
+
+void ImageCache::setBudget(qint64 bytes)
+{
+    std::lock_guard lock(m_mutex);
+
+    m_images.setMaxCost(std::max<qint64>(0, bytes / 1024));
+}
+
+void ImageCache::prefetch(const QStringList &paths, const QSize &size, bool crop)
+{
+    if (size.isEmpty()) {
+        return;
+    }
+
+    for (const QString &path : paths) {
+        // Cached slides are skipped when the job resolves their key
+        prefetch(pendingKey(path, size, crop), [path, size, crop] {
+            decodeSlide(path, size, crop);
+        });
+    }
+}
+
+void ImageCache::prefetch(const QString &key, const std::function<void()> &job)
+{
+    std::lock_guard lock(m_mutex);
+
+    if (m_pending.contains(key)) {
+        return;
+    }
+
+    m_pending.insert(key);
+    m_pool.start(new PrefetchRunnable(key, job));
+}
+
+void ImageCache::waitForPrefetch()
+{
+    m_pool.waitForDone();
+}
+
+void ImageCache::finishPrefetch(const QString &key)
+{
+    std::lock_guard lock(m_mutex);
+
+    m_pending.remove(key);
+}
+
+QImage ImageCache::decodeSlide(const QString &path, const QSize &size, bool crop, const std::atomic_bool *canceled)
+{
+    if (isCanceled(canceled)) {
+        return QImage();
+    }
+
+    const QString file = slideFile(path, size);
+
+    if (file.isEmpty()) {
+        return QImage();
+    }
+
+    // A canceled decode is not cached, a request waiting for it decodes the image itself
+    return self()->decode(cacheKey(file, size, cropFrame(crop)), [&file, &size, crop, canceled] {
+        return readImage(file, size, crop, canceled);
+    });
+}
+
+QImage ImageCache::readImage(const QString &file, const QSize &size, bool crop, const std::atomic_bool *canceled)
+{
+    QImageReader reader(file);
+    reader.setAutoTransform(true);
+
+    if (const QSize sourceSize = reader.size(); size.isValid() && sourceSize.isValid()) {
+        // The clip rect and the scaled size apply before the orientation from the metadata
+        const bool transposed = reader.transformation().testFlag(QImageIOHandler::TransformationRotate90);
+        const QSize orientedSize = transposed ? size.transposed() : size;
+        const QByteArray format = reader.format();
+        const bool isVector = format == "svg" || format == "svgz";
+
+        QSize visibleSize = sourceSize;
+
+        if (crop && !isVector) {
+            // Centered like Image.PreserveAspectCrop, the rest would be clipped away
+            visibleSize = orientedSize.scaled(sourceSize, Qt::KeepAspectRatio);
+
+            if (visibleSize.isEmpty()) {
+                visibleSize = sourceSize;
+            } else if (visibleSize != sourceSize) {
+                const QPoint topLeft((sourceSize.width() - visibleSize.width()) / 2, (sourceSize.height() - visibleSize.height()) / 2);
+                reader.setClipRect(QRect(topLeft, visibleSize));
+            }
+        }
+
+        const QSize scaledSize = visibleSize.scaled(orientedSize, Qt::KeepAspectRatioByExpanding);
+
+        // Vector images are rendered at the requested size. Large raster images are decoded
+        // at the size they are shown, e.g. JPEG scales down while decoding.
+        if (isVector || scaledSize.width() < visibleSize.width()) {
+            reader.setScaledSize(scaledSize);
+        }
+    }
+
+    if (isCanceled(canceled)) {
+        return QImage();
+    }
+
+    QImage image = reader.read();
+
+    if (isCanceled(canceled)) {
+        return QImage();
+    }
+
+    if (image.isNull() || !size.isValid()) {
+        return image;
+    }
+
+    // Cover the requested size, so every fill mode still gets enough pixels.
+    // Only needed if the reader does not know the size before decoding.
+    const QSize scaledSize = image.size().scaled(size, Qt::KeepAspectRatioByExpanding);
+
+    if (scaledSize.width() < image.width()) {
+        image = image.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    return image;
+}
+
+bool ImageCache::isCanceled(const std::atomic_bool *canceled)
+{
+    return canceled && canceled->load();
+}
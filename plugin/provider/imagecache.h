@@ -0,0 +1,171 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QSet>
+#include <QThreadPool>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+/**
+ * Decoded images shared by all screens, image items and image providers.
+ *
+ * An image is keyed by the file it is decoded from, the modification time
+ * of that file, the requested size and the frame of an XML slideshow. The
+ * same key is only decoded once at a time, other requests wait for that
+ * decode. Images are kept until the memory budget is used up, then the
+ * least recently used ones are dropped. Pinned images, e.g. the two ends
+ * of a running transition, are kept outside the budget.
+ *
+ * Slides and XML slideshow frames can also be decoded ahead of time, one
+ * at a time on a low priority thread.
+ */
+class ImageCache
+{
+public:
+    static ImageCache *self();
+
+    /**
+     * @param file the file the image is decoded from
+     * @param frame e.g. the transition step of an XML slideshow
+     */
+    static QString cacheKey(const QString &file, const QSize &size, const QString &frame = QString());
+
+    /**
+     * @return the path and modification time of @p file, to tell changed files apart
+     */
+    static QString fileKey(const QString &file);
+
+    /**
+     * @return the key of an image or of the preferred image of a package
+     */
+    static QString slideKey(const QString &path, const QSize &size, bool crop = false);
+
+    /**
+     * @return @c true if @p fillMode of an Image item only shows the part
+     * of the image that has the aspect ratio of the item
+     */
+    static bool isCropFillMode(int fillMode);
+
+    /**
+     * @return the cached image, or a null image
+     */
+    QImage find(const QString &key);
+    bool contains(const QString &key);
+    void insert(const QString &key, const QImage &image);
+    void clear();
+
+    /**
+     * @return the cached image, or the image decoded by @p decoder. If the
+     * same key is being decoded by another thread, waits for its result.
+     */
+    QImage decode(const QString &key, const std::function<QImage()> &decoder);
+
+    /**
+     * Keeps the images of @p keys outside the memory budget while @p owner
+     * uses them, including the ones that are not decoded yet. The keys that
+     * @p owner pinned before and that are not in @p keys go back to the
+     * budget.
+     */
+    void pin(const QString &owner, const QStringList &keys);
+    void unpin(const QString &owner);
+
+    /**
+     * Memory used by the cached images, in bytes
+     */
+    qint64 budget() const;
+    void setBudget(qint64 bytes);
+
+    /**
+     * Decodes @p paths that are not cached yet in the background.
+     *
+     * @param paths images or package folders
+     * @param crop see readImage()
+     */
+    void prefetch(const QStringList &paths, const QSize &size, bool crop = false);
+
+    /**
+     * Runs @p job in the background, unless a job with the same @p key is
+     * still queued. The job should decode through decode().
+     */
+    void prefetch(const QString &key, const std::function<void()> &job);
+
+    /**
+     * Blocks until every queued slide is decoded, for tests
+     */
+    void waitForPrefetch();
+
+    /**
+     * Decodes an image or the preferred image of a package for @p size
+     * through the cache.
+     *
+     * @param canceled see readImage()
+     */
+    static QImage decodeSlide(const QString &path, const QSize &size, bool crop = false, const std::atomic_bool *canceled = nullptr);
+
+    /**
+     * Reads @p file for @p size, without the cache.
+     * Large images are scaled down to cover @p size while they are decoded,
+     * small ones are kept.
+     *
+     * @param crop only decode the centered part of the image that has the
+     * aspect ratio of @p size, like Image.PreserveAspectCrop shows it
+     * @param canceled checked before decoding and before scaling, a null
+     * image is returned once it is set
+     */
+    static QImage readImage(const QString &file, const QSize &size, bool crop = false, const std::atomic_bool *canceled = nullptr);
+
+    /**
+     * @return @c true if @p canceled is set
+     */
+    static bool isCanceled(const std::atomic_bool *canceled);
+
+private:
+    ImageCache();
+    void insertLocked(const QString &key, const QImage &image);
+    void finishPrefetch(const QString &key);
+
+    static QString pendingKey(const QString &path, const QSize &size, bool crop);
+
+    /**
+     * @return @p path, or the preferred image if it is a package. The
+     * preferred image is cached until the images of the package change.
+     */
+    static QString slideFile(const QString &path, const QSize &size);
+
+    /**
+     * @return the frame part of the cache key of a cropped image
+     */
+    static QString cropFrame(bool crop);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_decoded;
+    QCache<QString, QImage> m_images; // Cost in KiB
+    QHash<QString, QImage> m_pinned; // Not in m_images
+    QHash<QString, int> m_pinCounts;
+    QHash<QString, QStringList> m_pinOwners;
+    QSet<QString> m_decoding;
+    QSet<QString> m_pending;
+    QThreadPool m_pool;
+
+    struct PackageFile {
+        qint64 modified = 0; // Of the images folder
+        QString preferred;
+    };
+    QHash<QString, PackageFile> m_packageFiles; // By package and size
+
+    friend class PrefetchRunnable;
+};
+
+#endif // IMAGECACHE_H
@@ -6,101 +6,10 @@
 
 #include "packageimageprovider.h"
 
-#include <QImageReader>
 #include <QUrlQuery>
 
-#include <KPackage/PackageLoader>
-
-#include "finder/packagefinder.h"
-
-class AsyncPackageImageResponseRunnable : public QObject, public QRunnable
-{
-    Q_OBJECT
-
-public:
-    explicit AsyncPackageImageResponseRunnable(const QString &path, const QSize &requestedSize);
-
-    /**
-     * Read the image and resize it if the requested size is valid.
-     */
-    void run() override;
-
-Q_SIGNALS:
-    void done(const QImage &image);
-
-private:
-    QString m_path;
-    QSize m_requestedSize;
-};
-
-class AsyncPackageImageResponse : public QQuickImageResponse
-{
-    Q_OBJECT
-
-public:
-    explicit AsyncPackageImageResponse(const QString &path, const QSize &requestedSize, QThreadPool *pool);
-
-    QQuickTextureFactory *textureFactory() const override;
-
-protected Q_SLOTS:
-    void slotHandleDone(const QImage &image);
-
-protected:
-    QImage m_image;
-};
-
-AsyncPackageImageResponseRunnable::AsyncPackageImageResponseRunnable(const QString &path, const QSize &requestedSize)
-    : m_path(path)
-    , m_requestedSize(requestedSize)
-{
-}
-
-void AsyncPackageImageResponseRunnable::run()
-{
-    const QUrlQuery urlQuery(QUrl(QStringLiteral("image://package/%1").arg(m_path)));
-    const QString dir = urlQuery.queryItemValue(QStringLiteral("dir"));
-
-    if (dir.isEmpty()) {
-        Q_EMIT done(QImage());
-        return;
-    }
-
-    KPackage::Package package = KPackage::PackageLoader::self()->loadPackage(QStringLiteral("Wallpaper/Images"));
-    package.setPath(dir);
-
-    if (!package.isValid()) {
-        Q_EMIT done(QImage());
-        return;
-    }
-
-    PackageFinder::findPreferredImageInPackage(package, m_requestedSize);
-
-    QImage image(package.filePath("preferred"));
-
-    if (!image.isNull() && m_requestedSize.isValid()) {
-        image = image.scaled(m_requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    }
-
-    Q_EMIT done(image);
-}
-
-AsyncPackageImageResponse::AsyncPackageImageResponse(const QString &path, const QSize &requestedSize, QThreadPool *pool)
-{
-    auto runnable = new AsyncPackageImageResponseRunnable(path, requestedSize);
-    connect(runnable, &AsyncPackageImageResponseRunnable::done, this, &AsyncPackageImageResponse::slotHandleDone);
-    pool->start(runnable);
-}
-
-void AsyncPackageImageResponse::slotHandleDone(const QImage &image)
-{
-    m_image = image;
-    Q_EMIT finished();
-}
-
-QQuickTextureFactory *AsyncPackageImageResponse::textureFactory() const
-{
-    return QQuickTextureFactory::textureFactoryForImage(m_image);
-}
+#include "asyncimageresponse.h"
+#include "imagecache.h"
 
 PackageImageProvider::PackageImageProvider()
 {
@@ -108,9 +17,14 @@ PackageImageProvider::PackageImageProvider()
 
 QQuickImageResponse *PackageImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
 {
-    AsyncPackageImageResponse *response = new AsyncPackageImageResponse(id, requestedSize, &m_pool);
-
-    return response;
+    const QUrlQuery urlQuery(QUrl(QStringLiteral("image://package/%1").arg(id)));
+    const QString dir = urlQuery.queryItemValue(QStringLiteral("dir"));
+    const bool crop = ImageCache::isCropFillMode(urlQuery.queryItemValue(QStringLiteral("fillmode")).toInt());
+
+    // Read the preferred image and resize it if the requested size is valid
+    return new AsyncImageResponse(
+        [dir, requestedSize, crop](const std::atomic_bool *canceled) {
+            return ImageCache::decodeSlide(dir, requestedSize, crop, canceled);
+        },
+        &m_pool);
 }
-
-#include "packageimageprovider.moc"
@@ -6,185 +6,155 @@
 
 #include "xmlimageprovider.h"
 
+#include <QCache>
 #include <QFileInfo>
-#include <QPainter>
+#include <QSet>
 #include <QUrlQuery>
 
-#include "finder/xmlfinder.h"
-#include "xmlslideshowupdatetimer.h"
+#include <mutex>
 
-class AsyncXmlImageResponseRunnable : public QObject, public QRunnable
-{
-    Q_OBJECT
-
-public:
-    explicit AsyncXmlImageResponseRunnable(const QString &path, const QSize &requestedSize);
-
-    /**
-     * Read the image and resize it if the requested size is valid.
-     */
-    void run() override;
-
-Q_SIGNALS:
-    void done(const QImage &image);
-
-private:
-    void blendImages(QImage &from, QImage &to, double toOpacity) const;
-
-    QString m_path;
-    QSize m_requestedSize;
-};
+#include "asyncimageresponse.h"
+#include "crossfade.h"
+#include "imagecache.h"
+#include "slideshowtimeline.h"
 
-class AsyncXmlImageResponse : public QQuickImageResponse
+namespace
 {
-    Q_OBJECT
+// Transition steps are shown once by the screens of one size and rendered
+// ahead by prerender(), so only the latest steps of each running transition
+// are kept, outside ImageCache
+constexpr int s_stepsPerTransition = 2;
 
-public:
-    explicit AsyncXmlImageResponse(const QString &path, const QSize &requestedSize, QThreadPool *pool);
+QCache<QString, QImage> s_steps;
+QSet<QString> s_transitions; // Path, size and fill mode of the running transitions
+std::mutex s_stepsMutex;
 
-    QQuickTextureFactory *textureFactory() const override;
+void setTransitionRunning(const QString &transition, bool running)
+{
+    std::lock_guard lock(s_stepsMutex);
 
-protected Q_SLOTS:
-    void slotHandleDone(const QImage &image);
+    if (running) {
+        s_transitions.insert(transition);
+    } else {
+        s_transitions.remove(transition);
+    }
 
-protected:
-    QImage m_image;
-};
+    s_steps.setMaxCost(s_transitions.size() * s_stepsPerTransition);
+}
+}
 
-AsyncXmlImageResponseRunnable::AsyncXmlImageResponseRunnable(const QString &path, const QSize &requestedSize)
-    : m_path(path)
-    , m_requestedSize(requestedSize)
+XmlImageProvider::XmlImageProvider()
 {
 }
 
-void AsyncXmlImageResponseRunnable::run()
+QQuickImageResponse *XmlImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
 {
-    const QUrlQuery urlQuery(QUrl(QStringLiteral("image://gnome-wp-list/%1").arg(m_path)));
+    const QUrlQuery urlQuery(QUrl(QStringLiteral("image://gnome-wp-list/%1").arg(id)));
 
     const QString filename = urlQuery.queryItemValue(QStringLiteral("filename"));
     const QString filename_dark = urlQuery.queryItemValue(QStringLiteral("filename_dark"));
     const bool useDark = urlQuery.queryItemValue(QStringLiteral("darkmode")).toInt() == 1;
+    const bool crop = ImageCache::isCropFillMode(urlQuery.queryItemValue(QStringLiteral("fillmode")).toInt());
 
-    QString path = filename;
-    const QFileInfo info(filename);
-
-    if (!info.exists()) {
-        Q_EMIT done(QImage());
-        return;
-    }
+    return new AsyncImageResponse(
+        [filename, filename_dark, useDark, requestedSize, crop](const std::atomic_bool *canceled) {
+            if (!QFileInfo::exists(filename)) {
+                return QImage();
+            }
 
-    if (useDark && !filename_dark.isEmpty() && QFile::exists(filename_dark)) {
-        path = filename_dark;
-    }
+            QString path = filename;
 
-    if (path.endsWith(QStringLiteral(".xml"), Qt::CaseInsensitive)) {
-        const SlideshowData sData = XmlFinder::parseSlideshowXml(path, m_requestedSize);
+            if (useDark && !filename_dark.isEmpty() && QFile::exists(filename_dark)) {
+                path = filename_dark;
+            }
 
-        if (sData.data.empty()) {
-            Q_EMIT done(QImage());
-            return;
-        }
+            return renderFrame(path, requestedSize, QDateTime::currentDateTime(), crop, canceled);
+        },
+        &m_pool);
+}
 
-        const QDateTime startTime = XmlSlideshowUpdateTimer::slideshowStartTime(sData);
-        const qint64 timeDiff = startTime.secsTo(QDateTime::currentDateTime());
+QImage XmlImageProvider::renderFrame(const QString &path, const QSize &size, const QDateTime &time, bool crop, const std::atomic_bool *canceled)
+{
+    QString file = path;
 
-        // Caculate cycle length
-        TimeList timeList;
-        qint64 totalTime;
-        std::tie(timeList, totalTime) = XmlSlideshowUpdateTimer::slideshowTimeList(sData);
+    if (path.endsWith(QStringLiteral(".xml"), Qt::CaseInsensitive)) {
+        const auto timeline = SlideshowTimeline::load(path, size);
 
-        if (totalTime > 0) {
-            // Mod
-            const qint64 modTime = timeDiff % totalTime;
+        if (!timeline) {
+            return QImage();
+        }
 
-            for (int i = 0; i < static_cast<int>(timeList.size()); i++) {
-                const auto &nextP = timeList.at(i);
+        const SlideshowTimeline::Frame frame = timeline->frameAt(time);
 
-                if (nextP.second > modTime) {
-                    const auto &p = timeList.at(i - 1);
-                    const SlideshowItemData &item = sData.data.at(i - 1);
+        const QString transition = ImageCache::slideKey(path, size, crop);
 
-                    if (p.first == 0) {
-                        // static
-                        path = item.file;
-                    } else {
-                        // Blend two images, like gdk_pixbuf_composite
-                        QImage from(item.from);
-                        QImage to(item.to);
-                        const double opacity = 1.0 - (nextP.second - modTime) / static_cast<double>(nextP.second - p.second);
+        if (frame.isTransition) {
+            // Both ends are decoded once at the requested size and kept for the whole transition
+            ImageCache::self()->pin(transition, {ImageCache::slideKey(frame.file, size, crop), ImageCache::slideKey(frame.to, size, crop)});
+            setTransitionRunning(transition, true);
 
-                        blendImages(from, to, opacity);
+            // Rounded, so all screens share the same frame
+            const int step = qRound(frame.progress * 255);
+            QString stepKey = ImageCache::fileKey(frame.to) + QLatin1Char('/') + QString::number(step);
 
-                        if (!from.isNull() && m_requestedSize.isValid()) {
-                            from = from.scaled(m_requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                        }
+            if (crop) {
+                stepKey += QStringLiteral("/crop");
+            }
 
-                        Q_EMIT done(from);
-                        return;
-                    }
+            stepKey = ImageCache::cacheKey(frame.file, size, stepKey);
 
-                    break;
-                }
+            if (const QImage image = findStep(stepKey); !image.isNull()) {
+                return image;
             }
-        }
-    }
 
-    QImage image(path);
+            const QImage from = ImageCache::decodeSlide(frame.file, size, crop, canceled);
+            const QImage to = ImageCache::decodeSlide(frame.to, size, crop, canceled);
 
-    if (!image.isNull() && m_requestedSize.isValid()) {
-        image = image.scaled(m_requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    }
+            // The ends stay cached, only the blend is skipped
+            if (ImageCache::isCanceled(canceled)) {
+                return QImage();
+            }
 
-    Q_EMIT done(image);
-}
+            const QImage image = crossFade(from, to, step);
 
-void AsyncXmlImageResponseRunnable::blendImages(QImage &from, QImage &to, double toOpacity) const
-{
-    if (from.isNull() || toOpacity < 0 || toOpacity > 1) {
-        return;
-    }
+            if (!image.isNull()) {
+                std::lock_guard lock(s_stepsMutex);
+                s_steps.insert(stepKey, new QImage(image));
+            }
 
-    from = from.convertToFormat(QImage::Format_ARGB32);
-    to = to.convertToFormat(QImage::Format_ARGB32);
+            return image;
+        }
 
-    auto p = std::make_unique<QPainter>();
+        // The ends of the last transition go back to the budget of ImageCache
+        ImageCache::self()->unpin(transition);
+        setTransitionRunning(transition, false);
 
-    if (!p->begin(&from)) {
-        return;
+        // static
+        file = frame.file;
     }
 
-    p->setOpacity(toOpacity);
-    p->drawImage(QRect(0, 0, from.width(), from.height()), to);
-    p->end();
+    return ImageCache::decodeSlide(file, size, crop, canceled);
 }
 
-AsyncXmlImageResponse::AsyncXmlImageResponse(const QString &path, const QSize &requestedSize, QThreadPool *pool)
+QImage XmlImageProvider::findStep(const QString &key)
 {
-    auto runnable = new AsyncXmlImageResponseRunnable(path, requestedSize);
-    connect(runnable, &AsyncXmlImageResponseRunnable::done, this, &AsyncXmlImageResponse::slotHandleDone);
-    pool->start(runnable);
-}
+    std::lock_guard lock(s_stepsMutex);
 
-void AsyncXmlImageResponse::slotHandleDone(const QImage &image)
-{
-    m_image = image;
-    Q_EMIT finished();
-}
+    const QImage *image = s_steps.object(key);
 
-QQuickTextureFactory *AsyncXmlImageResponse::textureFactory() const
-{
-    return QQuickTextureFactory::textureFactoryForImage(m_image);
+    return image ? *image : QImage();
 }
 
-XmlImageProvider::XmlImageProvider()
+void XmlImageProvider::prerender(const QString &path, const QSize &size, const QDateTime &time, bool crop)
 {
-}
+    if (path.isEmpty() || size.isEmpty()) {
+        return;
+    }
 
-QQuickImageResponse *XmlImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
-{
-    AsyncXmlImageResponse *response = new AsyncXmlImageResponse(id, requestedSize, &m_pool);
+    const QString key = QStringLiteral("%1@%2x%3@%4#%5")
+                            .arg(path, QString::number(size.width()), QString::number(size.height()), QString::number(time.toSecsSinceEpoch()), QString::number(crop));
 
-    return response;
+    ImageCache::self()->prefetch(key, [path, size, time, crop] {
+        renderFrame(path, size, time, crop);
+    });
 }
-
-#include "xmlimageprovider.moc"
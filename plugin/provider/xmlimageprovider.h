@@ -7,9 +7,12 @@
 #ifndef XMLIMAGEPROVIDER_H
 #define XMLIMAGEPROVIDER_H
 
+#include <QDateTime>
 #include <QQuickAsyncImageProvider>
 #include <QThreadPool>
 
+#include <atomic>
+
 /**
  * A custom image provider for XML wallpapers
  */
@@ -20,8 +23,33 @@ public:
 
     QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
 
+    /**
+     * Renders the frame of the XML slideshow in @p path shown at @p time,
+     * through ImageCache. A plain image is decoded as it is.
+     *
+     * The two ends of a running transition are pinned in ImageCache, the
+     * steps of the transition are not cached there.
+     *
+     * @param crop see ImageCache::readImage()
+     * @param canceled see ImageCache::readImage()
+     */
+    static QImage renderFrame(const QString &path, const QSize &size, const QDateTime &time, bool crop = false, const std::atomic_bool *canceled = nullptr);
+
+    /**
+     * Renders the frame shown at @p time in the background, so it is cached
+     * when it is requested.
+     */
+    static void prerender(const QString &path, const QSize &size, const QDateTime &time, bool crop = false);
+
 private:
+    /**
+     * @return a recent step of a running transition, or a null image
+     */
+    static QImage findStep(const QString &key);
+
     QThreadPool m_pool;
+
+    friend class ImageCacheTest;
 };
 
 #endif // XMLIMAGEPROVIDER_H
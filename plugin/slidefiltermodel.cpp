@@ -8,14 +8,13 @@
 
 #include "slidemodel.h"
 
-#include <QDateTime>
-#include <QDir>
-#include <QFileInfo>
 #include <QRandomGenerator>
+#include <QThreadPool>
 
 #include <KIO/OpenFileManagerWindowJob>
 
 #include <algorithm>
+#include <numeric>
 
 SlideFilterModel::SlideFilterModel(QObject *parent)
     : QSortFilterProxyModel{parent}
@@ -24,6 +23,8 @@ SlideFilterModel::SlideFilterModel(QObject *parent)
     , m_usedInConfig{false}
     , m_random(m_randomDevice())
 {
+    qRegisterMetaType<QList<SlideSortKey>>();
+
     srand(time(nullptr));
     setSortCaseSensitivity(Qt::CaseSensitivity::CaseInsensitive);
     connect(this, &SlideFilterModel::usedInConfigChanged, this, &SlideFilterModel::invalidateFilter);
@@ -40,8 +41,16 @@ QHash<int, QByteArray> SlideFilterModel::roleNames() const
 
 bool SlideFilterModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
 {
-    auto index = sourceModel()->index(source_row, 0, source_parent);
-    return m_usedInConfig || index.data(ImageRoles::ToggleRole).toBool();
+    if (m_usedInConfig) {
+        return true;
+    }
+
+    // The checked state is cached by row, so no role data is queried here
+    if (m_slideModel) {
+        return m_slideModel->isChecked(source_row);
+    }
+
+    return sourceModel()->index(source_row, 0, source_parent).data(ImageRoles::ToggleRole).toBool();
 }
 
 void SlideFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
@@ -49,117 +58,147 @@ void SlideFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
     if (this->sourceModel()) {
         disconnect(this->sourceModel(), nullptr, this, nullptr);
     }
+    m_slideModel = qobject_cast<SlideModel *>(sourceModel);
+    m_sortKeys.clear();
     QSortFilterProxyModel::setSourceModel(sourceModel);
     if (m_SortingMode == SortingMode::Random && !m_usedInConfig) {
         buildRandomOrder();
     }
     if (sourceModel) {
         connect(sourceModel, &QAbstractItemModel::modelReset, this, &SlideFilterModel::buildRandomOrder);
-        connect(sourceModel, &QAbstractItemModel::rowsInserted, this, [this] {
-            if (m_SortingMode != SortingMode::Random || m_usedInConfig) {
+        // The ranks must be ready before the new rows are sorted in rowsInserted
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeInserted, this, [this](const QModelIndex &, int first, int last) {
+            if (m_SortingMode != SortingMode::Random || m_usedInConfig || first > m_randomRanks.size()) {
                 return;
             }
-            const int old_count = m_randomOrder.size();
-            m_randomOrder.resize(this->sourceModel()->rowCount());
-            std::iota(m_randomOrder.begin() + old_count, m_randomOrder.end(), old_count);
-            std::shuffle(m_randomOrder.begin() + old_count, m_randomOrder.end(), m_random);
+            // New rows are shuffled after the existing ones
+            QVector<int> ranks(last - first + 1);
+            std::iota(ranks.begin(), ranks.end(), m_nextRandomRank);
+            std::shuffle(ranks.begin(), ranks.end(), m_random);
+            m_nextRandomRank += ranks.size();
+            m_randomRanks.insert(first, ranks.size(), 0);
+            std::copy(ranks.cbegin(), ranks.cend(), m_randomRanks.begin() + first);
         });
-        connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, [this] {
-            if (m_SortingMode != SortingMode::Random || m_usedInConfig) {
+        connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &, int first, int last) {
+            if (m_SortingMode != SortingMode::Random || m_usedInConfig || last >= m_randomRanks.size()) {
                 return;
             }
-            m_randomOrder.erase(std::remove_if(m_randomOrder.begin(),
-                                               m_randomOrder.end(),
-                                               [this](const int v) {
-                                                   return v >= this->sourceModel()->rowCount();
-                                               }),
-                                m_randomOrder.end());
+            m_randomRanks.remove(first, last - first + 1);
+        });
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeInserted, this, [this](const QModelIndex &, int first, int last) {
+            if (first <= m_sortKeys.size()) {
+                m_sortKeys.insert(first, last - first + 1, SlideSortKey());
+            }
+        });
+        connect(sourceModel, &QAbstractItemModel::rowsInserted, this, [this] {
+            gatherSortKeys();
         });
+        connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &, int first, int last) {
+            if (last < m_sortKeys.size()) {
+                m_sortKeys.remove(first, last - first + 1);
+            } else {
+                m_sortKeys.resize(std::min(first, m_sortKeys.size()));
+            }
+        });
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles) {
+            if (!roles.empty() && !roles.contains(ImageRoles::PathRole)) {
+                return;
+            }
+            // The file has changed
+            for (int row = topLeft.row(); row <= bottomRight.row() && row < m_sortKeys.size(); row++) {
+                m_sortKeys[row] = SlideSortKey();
+            }
+            gatherSortKeys();
+        });
+        const auto clearSortKeys = [this] {
+            m_sortKeys.clear();
+            gatherSortKeys();
+        };
+        connect(sourceModel, &QAbstractItemModel::modelReset, this, clearSortKeys);
+        connect(sourceModel, &QAbstractItemModel::layoutChanged, this, clearSortKeys);
+        connect(sourceModel, &QAbstractItemModel::rowsMoved, this, clearSortKeys);
     }
+    gatherSortKeys();
 }
 
 bool SlideFilterModel::lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const
 {
-    Qt::CaseSensitivity cs = Qt::CaseInsensitive;
-
-    switch (m_SortingMode) {
-    case SortingMode::Random:
+    if (m_SortingMode == SortingMode::Random) {
         if (m_usedInConfig) {
             return source_left.row() < source_right.row();
         }
-        return m_randomOrder.indexOf(source_left.row()) < m_randomOrder.indexOf(source_right.row());
+        return randomRank(source_left.row()) < randomRank(source_right.row());
+    }
+
+    const SlideSortKey *left = sortKey(source_left.row());
+    const SlideSortKey *right = sortKey(source_right.row());
+
+    // Slides still waiting for their keys stay at the end until the keys are found
+    if (!left || !right) {
+        if (left || right) {
+            return left;
+        }
+        return source_left.row() < source_right.row();
+    }
+
+    switch (m_SortingMode) {
     case SortingMode::Alphabetical:
         if (m_SortingFoldersFirst) {
-            QFileInfo leftFile(getLocalFilePath(source_left));
-            QFileInfo rightFile(getLocalFilePath(source_right));
-            QString leftFilePath = getFilePathWithDir(leftFile);
-            QString rightFilePath = getFilePathWithDir(rightFile);
-
-            if (leftFilePath == rightFilePath) {
-                return QString::compare(leftFile.fileName(), rightFile.fileName(), cs) < 0;
-            } else if (leftFilePath.startsWith(rightFilePath, cs)) {
+            if (left->folder == right->folder) {
+                return left->fileName < right->fileName;
+            } else if (left->folder.startsWith(right->folder)) {
                 return true;
-            } else if (rightFilePath.startsWith(leftFilePath, cs)) {
+            } else if (right->folder.startsWith(left->folder)) {
                 return false;
             } else {
-                return QString::compare(leftFilePath, rightFilePath, cs) < 0;
+                return left->folder < right->folder;
             }
         } else {
-            QFileInfo leftFile(getLocalFilePath(source_left));
-            QFileInfo rightFile(getLocalFilePath(source_right));
-            return QString::compare(leftFile.fileName(), rightFile.fileName(), cs) < 0;
+            return left->fileName < right->fileName;
         }
     case SortingMode::AlphabeticalReversed:
         if (m_SortingFoldersFirst) {
-            QFileInfo leftFile(getLocalFilePath(source_left));
-            QFileInfo rightFile(getLocalFilePath(source_right));
-            QString leftFilePath = getFilePathWithDir(leftFile);
-            QString rightFilePath = getFilePathWithDir(rightFile);
-
-            if (leftFilePath == rightFilePath) {
-                return QString::compare(leftFile.fileName(), rightFile.fileName(), cs) > 0;
-            } else if (leftFilePath.startsWith(rightFilePath, cs)) {
+            if (left->folder == right->folder) {
+                return left->fileName > right->fileName;
+            } else if (left->folder.startsWith(right->folder)) {
                 return true;
-            } else if (rightFilePath.startsWith(leftFilePath, cs)) {
+            } else if (right->folder.startsWith(left->folder)) {
                 return false;
             } else {
-                return QString::compare(leftFilePath, rightFilePath, cs) > 0;
+                return left->folder > right->folder;
             }
         } else {
-            QFileInfo leftFile(getLocalFilePath(source_left));
-            QFileInfo rightFile(getLocalFilePath(source_right));
-            return QString::compare(leftFile.fileName(), rightFile.fileName(), cs) > 0;
+            return left->fileName > right->fileName;
         }
     case SortingMode::Modified: // oldest first
-    {
-        QFileInfo leftFile(getLocalFilePath(source_left));
-        QFileInfo rightFile(getLocalFilePath(source_right));
-        return leftFile.lastModified() < rightFile.lastModified();
-    }
+        return left->modified < right->modified;
     case SortingMode::ModifiedReversed: // newest first
-    {
-        QFileInfo leftFile(getLocalFilePath(source_left));
-        QFileInfo rightFile(getLocalFilePath(source_right));
-        return !(leftFile.lastModified() < rightFile.lastModified());
-    }
+        return !(left->modified < right->modified);
+    case SortingMode::Random:
+    case SortingMode::Sampling:
+        break;
     }
     Q_UNREACHABLE();
 }
 
 void SlideFilterModel::setSortingMode(SortingMode::Mode slideshowMode, bool slideshowFoldersFirst)
 {
-    m_SortingMode = slideshowMode;
+    // The slides listed in the config dialog are shuffled when sampling
+    m_SortingMode = slideshowMode == SortingMode::Sampling ? SortingMode::Random : slideshowMode;
     m_SortingFoldersFirst = slideshowFoldersFirst;
     if (m_SortingMode == SortingMode::Random && !m_usedInConfig) {
         buildRandomOrder();
     }
+    // Missing keys are read in the background, and the slides are sorted
+    // again when they are found
+    gatherSortKeys();
     QSortFilterProxyModel::invalidate();
 }
 
 void SlideFilterModel::invalidate()
 {
     if (m_SortingMode == SortingMode::Random && !m_usedInConfig) {
-        std::shuffle(m_randomOrder.begin(), m_randomOrder.end(), m_random);
+        std::shuffle(m_randomRanks.begin(), m_randomRanks.end(), m_random);
     }
     QSortFilterProxyModel::invalidate();
 }
@@ -174,7 +213,10 @@ int SlideFilterModel::indexOf(const QString &path)
     if (!sourceModel())
         return -1;
 
-    auto sourceIndex = sourceModel()->index(static_cast<SlideModel *>(sourceModel())->indexOf(path), 0);
+    if (!m_slideModel)
+        return -1;
+
+    auto sourceIndex = sourceModel()->index(m_slideModel->indexOf(path), 0);
     return mapFromSource(sourceIndex).row();
 }
 
@@ -186,18 +228,101 @@ void SlideFilterModel::openContainingFolder(int rowIndex)
 void SlideFilterModel::buildRandomOrder()
 {
     if (sourceModel()) {
-        m_randomOrder.resize(sourceModel()->rowCount());
-        std::iota(m_randomOrder.begin(), m_randomOrder.end(), 0);
-        std::shuffle(m_randomOrder.begin(), m_randomOrder.end(), m_random);
+        m_randomRanks.resize(sourceModel()->rowCount());
+        std::iota(m_randomRanks.begin(), m_randomRanks.end(), 0);
+        std::shuffle(m_randomRanks.begin(), m_randomRanks.end(), m_random);
+        m_nextRandomRank = m_randomRanks.size();
     }
 }
 
-QString SlideFilterModel::getLocalFilePath(const QModelIndex &modelIndex) const
+int SlideFilterModel::randomRank(int sourceRow) const
 {
-    return modelIndex.data(ImageRoles::PathRole).toUrl().toLocalFile();
+    // Rows the ranks don't know yet keep their order after the known ones
+    return sourceRow < m_randomRanks.size() ? m_randomRanks.at(sourceRow) : m_nextRandomRank + sourceRow;
 }
 
-QString SlideFilterModel::getFilePathWithDir(const QFileInfo &fileInfo) const
+bool SlideFilterModel::sortKeysPending() const
 {
-    return fileInfo.canonicalPath().append(QDir::separator());
+    return m_pendingSortKeys > 0;
+}
+
+void SlideFilterModel::slotSortKeysFound(const QList<SlideSortKey> &keys)
+{
+    m_pendingSortKeys--;
+
+    QHash<QString, SlideSortKey> keysByPath;
+    keysByPath.reserve(keys.size());
+
+    for (const SlideSortKey &key : keys) {
+        keysByPath.insert(key.path, key);
+    }
+
+    bool changed = false;
+
+    for (int row = 0; row < m_sortKeys.size(); row++) {
+        if (m_sortKeys.at(row).valid) {
+            continue;
+        }
+
+        const auto it = keysByPath.constFind(getLocalFilePath(sourceModel()->index(row, 0)));
+
+        if (it != keysByPath.cend()) {
+            m_sortKeys[row] = *it;
+            changed = true;
+        }
+    }
+
+    if (changed && m_SortingMode != SortingMode::Random) {
+        // Sorts again without reshuffling
+        QSortFilterProxyModel::invalidate();
+    }
+
+    if (m_pendingSortKeys == 0) {
+        Q_EMIT sortKeysReady();
+    }
+}
+
+void SlideFilterModel::gatherSortKeys()
+{
+    if (!sourceModel() || m_SortingMode == SortingMode::Random) {
+        return;
+    }
+
+    const int rowCount = sourceModel()->rowCount();
+    m_sortKeys.resize(rowCount);
+
+    QStringList paths;
+
+    for (int row = 0; row < rowCount; row++) {
+        if (m_sortKeys.at(row).valid) {
+            continue;
+        }
+
+        paths.append(getLocalFilePath(sourceModel()->index(row, 0)));
+    }
+
+    if (paths.empty()) {
+        return;
+    }
+
+    paths.removeDuplicates();
+
+    auto finder = new SortKeyFinder(paths);
+    connect(finder, &SortKeyFinder::sortKeysFound, this, &SlideFilterModel::slotSortKeysFound);
+    m_pendingSortKeys++;
+    QThreadPool::globalInstance()->start(finder);
+}
+
+const SlideSortKey *SlideFilterModel::sortKey(int sourceRow) const
+{
+    if (sourceRow >= m_sortKeys.size() || !m_sortKeys.at(sourceRow).valid) {
+        return nullptr;
+    }
+
+    return &m_sortKeys.at(sourceRow);
+}
+
+QString SlideFilterModel::getLocalFilePath(const QModelIndex &modelIndex) const
+{
+    return modelIndex.data(ImageRoles::PathRole).toUrl().toLocalFile();
 }
@@ -12,8 +12,11 @@
 
 #include <random>
 
+#include "finder/sortkeyfinder.h"
 #include "sortingmode.h"
 
+class SlideModel;
+
 class SlideFilterModel : public QSortFilterProxyModel
 {
     Q_OBJECT
@@ -32,19 +35,44 @@ public:
     void invalidate();
     void invalidateFilter();
 
+    /**
+     * @return @c true while sort keys are being read in the background
+     */
+    bool sortKeysPending() const;
+
     Q_INVOKABLE int indexOf(const QString &path);
     Q_INVOKABLE void openContainingFolder(int rowIndex);
 
 Q_SIGNALS:
     void usedInConfigChanged();
+    /**
+     * Emitted when all sort keys are read and the slides are sorted
+     */
+    void sortKeysReady();
+
+private Q_SLOTS:
+    void slotSortKeysFound(const QList<SlideSortKey> &keys);
 
 private:
     void buildRandomOrder();
+    int randomRank(int sourceRow) const;
+
+    /**
+     * Reads the missing sort keys in the background, sortKeysReady is
+     * emitted when all of them are found
+     */
+    void gatherSortKeys();
+    const SlideSortKey *sortKey(int sourceRow) const;
 
     QString getLocalFilePath(const QModelIndex &modelIndex) const;
-    QString getFilePathWithDir(const QFileInfo &fileInfo) const;
 
-    QVector<int> m_randomOrder;
+    SlideModel *m_slideModel = nullptr;
+    // Position of each source row in the random order
+    QVector<int> m_randomRanks;
+    int m_nextRandomRank = 0;
+    // Sort keys of each source row, invalid until read
+    QVector<SlideSortKey> m_sortKeys;
+    int m_pendingSortKeys = 0;
     SortingMode::Mode m_SortingMode;
     bool m_SortingFoldersFirst;
     bool m_usedInConfig;
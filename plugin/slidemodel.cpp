@@ -8,26 +8,32 @@
 
 #include <QDir>
 
+#include <algorithm>
+
 #include "model/imageproxymodel.h"
 
 SlideModel::SlideModel(const QSize &targetSize, QObject *parent)
-    : QConcatenateTablesProxyModel(parent)
+    : QIdentityProxyModel(parent)
     , m_targetSize(targetSize)
 {
     connect(this, &SlideModel::targetSizeChanged, [this](const QSize &s) {
         m_targetSize = s;
     });
+
+    connect(this, &SlideModel::rowsInserted, this, &SlideModel::slotRowsInserted);
+    connect(this, &SlideModel::rowsRemoved, this, &SlideModel::slotRowsRemoved);
+    connect(this, &SlideModel::rowsMoved, this, &SlideModel::rebuildCheckedRows);
+    connect(this, &SlideModel::modelReset, this, &SlideModel::rebuildCheckedRows);
+    connect(this, &SlideModel::layoutChanged, this, &SlideModel::rebuildCheckedRows);
 }
 
 QHash<int, QByteArray> SlideModel::roleNames() const
 {
-    const auto models = sourceModels();
-
-    if (!models.empty()) {
-        return models.at(0)->roleNames();
+    if (sourceModel()) {
+        return sourceModel()->roleNames();
     }
 
-    return QConcatenateTablesProxyModel::roleNames();
+    return QIdentityProxyModel::roleNames();
 }
 
 QVariant SlideModel::data(const QModelIndex &index, int role) const
@@ -37,10 +43,10 @@ QVariant SlideModel::data(const QModelIndex &index, int role) const
     }
 
     if (role == ToggleRole) {
-        return m_checkedTable.value(index.data(PackageNameRole).toString(), true);
+        return isChecked(index.row());
     }
 
-    return QConcatenateTablesProxyModel::data(index, role);
+    return QIdentityProxyModel::data(index, role);
 }
 
 bool SlideModel::setData(const QModelIndex &index, const QVariant &value, int role)
@@ -50,29 +56,33 @@ bool SlideModel::setData(const QModelIndex &index, const QVariant &value, int ro
     }
 
     if (role == ToggleRole) {
-        m_checkedTable[index.data(PackageNameRole).toString()] = value.toBool();
+        const bool checked = value.toBool();
+        const QString packagePath = index.data(PackageNameRole).toString();
+
+        if (index.row() < static_cast<int>(m_checkedRows.size())) {
+            m_checkedRows[index.row()] = checked;
+        }
+
+        if (checked) {
+            m_uncheckedSlides.remove(packagePath);
+        } else {
+            m_uncheckedSlides.insert(packagePath);
+        }
 
         Q_EMIT dataChanged(index, index, {ToggleRole});
         return true;
     }
 
-    return QConcatenateTablesProxyModel::setData(index, value, role);
+    return QIdentityProxyModel::setData(index, value, role);
 }
 
 int SlideModel::indexOf(const QString &packagePath) const
 {
-    int idx = -1;
-    const auto models = sourceModels();
-
-    for (const auto &m : models) {
-        idx = static_cast<const ImageProxyModel *>(m)->indexOf(packagePath);
-
-        if (idx >= 0) {
-            return mapFromSource(m->index(idx, 0)).row();
-        }
+    if (!m_model) {
+        return -1;
     }
 
-    return idx;
+    return mapFromSource(m_model->index(m_model->indexOf(packagePath), 0)).row();
 }
 
 QStringList SlideModel::addDirs(const QStringList &dirs)
@@ -86,16 +96,16 @@ QStringList SlideModel::addDirs(const QStringList &dirs)
 
         const QString d = _d.endsWith(QDir::separator()) ? _d : _d + QDir::separator();
 
-        if (!m_models.contains(d)) {
-            auto m = new ImageProxyModel({d}, m_targetSize, this);
-
-            connect(m, &ImageProxyModel::loadingChanged, this, &SlideModel::slotSourceModelLoadingChanged);
-
-            m_models.insert(d, m);
+        if (!m_slidePaths.contains(d) && !added.contains(d)) {
             added.append(d);
         }
     }
 
+    if (!added.empty()) {
+        m_slidePaths += added;
+        updateModel(true);
+    }
+
     return added;
 }
 
@@ -103,63 +113,137 @@ QString SlideModel::removeDir(const QString &_dir)
 {
     const QString dir = _dir.endsWith(QDir::separator()) ? _dir : _dir + QDir::separator();
 
-    if (!m_models.contains(dir)) {
+    if (!m_slidePaths.removeOne(dir)) {
         return QString();
     }
 
-    auto *m = m_models.take(dir);
-
-    m_loaded--;
-    removeSourceModel(m);
-    m->deleteLater();
+    updateModel(false);
 
     return dir;
 }
 
 void SlideModel::setSlidePaths(const QStringList &slidePaths)
 {
-    const auto models = sourceModels();
+    m_slidePaths.clear();
 
-    for (const auto &k : std::as_const(m_models)) {
-        if (models.contains(k)) {
-            removeSourceModel(k);
-        } else {
-            // Abort loading
-            disconnect(k, nullptr, this, nullptr);
-        }
-        k->deleteLater();
+    addDirs(slidePaths);
+
+    if (m_slidePaths.empty()) {
+        updateModel(false);
     }
+}
 
-    m_models.clear();
-    m_loaded = 0;
+void SlideModel::setUncheckedSlides(const QStringList &uncheckedSlides)
+{
+    m_uncheckedSlides = QSet<QString>(uncheckedSlides.cbegin(), uncheckedSlides.cend());
 
-    addDirs(slidePaths);
+    rebuildCheckedRows();
 }
 
-void SlideModel::setUncheckedSlides(const QStringList &uncheckedSlides)
+void SlideModel::updateModel(bool notify)
 {
-    m_checkedTable.clear();
+    if (m_slidePaths.empty()) {
+        if (m_model) {
+            setSourceModel(nullptr);
+            m_model->deleteLater();
+            m_model = nullptr;
+        }
+    } else if (!m_model) {
+        m_model = new ImageProxyModel(m_slidePaths, m_targetSize, this);
+        connect(this, &SlideModel::targetSizeChanged, m_model, &ImageProxyModel::targetSizeChanged);
+        connect(m_model, &ImageProxyModel::loadingChanged, this, &SlideModel::slotSourceModelLoadingChanged);
+        setSourceModel(m_model);
+    } else {
+        QStringList paths;
+        for (const QString &path : std::as_const(m_slidePaths)) {
+            paths.append(ImageProxyModel::normalizedRoot(path));
+        }
 
-    for (const QString &p : uncheckedSlides) {
-        m_checkedTable[p] = false;
+        const QStringList roots = m_model->roots();
+        QStringList addedRoots;
+        QStringList removedRoots;
+
+        std::copy_if(paths.cbegin(), paths.cend(), std::back_inserter(addedRoots), [&roots](const QString &path) {
+            return !roots.contains(path);
+        });
+        std::copy_if(roots.cbegin(), roots.cend(), std::back_inserter(removedRoots), [&paths](const QString &root) {
+            return !paths.contains(root);
+        });
+
+        // Only the difference is scanned, and the folders loaded by other
+        // screens are not scanned at all
+        m_model->addRoots(addedRoots);
+        m_model->removeRoots(removedRoots);
+    }
+
+    if (!notify || !m_model) {
+        m_waitingForModel = false;
+        return;
+    }
+
+    m_waitingForModel = m_model->loading();
+
+    if (!m_waitingForModel) {
+        // The model may be already loaded for another screen
+        QMetaObject::invokeMethod(this, &SlideModel::done, Qt::QueuedConnection);
     }
 }
 
 void SlideModel::slotSourceModelLoadingChanged()
 {
-    auto m = qobject_cast<ImageProxyModel *>(sender());
+    if (!m_waitingForModel || m_model->loading()) {
+        return;
+    }
+
+    m_waitingForModel = false;
+    Q_EMIT done();
+}
 
-    if (!m) {
+void SlideModel::slotRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
         return;
     }
 
-    disconnect(m, &ImageProxyModel::loadingChanged, this, nullptr);
+    if (first > static_cast<int>(m_checkedRows.size())) {
+        rebuildCheckedRows();
+        return;
+    }
 
-    connect(this, &SlideModel::targetSizeChanged, m, &ImageProxyModel::targetSizeChanged);
+    m_checkedRows.insert(m_checkedRows.begin() + first, last - first + 1, true);
 
-    addSourceModel(m);
+    if (m_uncheckedSlides.empty()) {
+        return;
+    }
+
+    for (int row = first; row <= last; row++) {
+        m_checkedRows[row] = !m_uncheckedSlides.contains(index(row, 0).data(PackageNameRole).toString());
+    }
+}
+
+void SlideModel::slotRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    if (last >= static_cast<int>(m_checkedRows.size())) {
+        rebuildCheckedRows();
+        return;
+    }
+
+    m_checkedRows.erase(m_checkedRows.begin() + first, m_checkedRows.begin() + last + 1);
+}
+
+void SlideModel::rebuildCheckedRows()
+{
+    m_checkedRows.assign(rowCount(), true);
+
+    if (m_uncheckedSlides.empty()) {
+        return;
+    }
 
-    if (++m_loaded == m_models.size()) {
-        Q_EMIT done();
+    for (int row = 0; row < rowCount(); row++) {
+        m_checkedRows[row] = !m_uncheckedSlides.contains(index(row, 0).data(PackageNameRole).toString());
     }
 }
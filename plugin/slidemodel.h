@@ -6,15 +6,23 @@
 
 #pragma once
 
-#include <QConcatenateTablesProxyModel>
+#include <QIdentityProxyModel>
 #include <QSet>
 #include <QSize>
 
+#include <vector>
+
 #include "model/imageroles.h"
 
 class ImageProxyModel;
 
-class SlideModel : public QConcatenateTablesProxyModel, public ImageRoles
+/**
+ * A flat view over one ImageProxyModel that scans all slide paths.
+ *
+ * Overlapping slide paths are scanned once, and adding or removing a path
+ * only scans the difference.
+ */
+class SlideModel : public QIdentityProxyModel, public ImageRoles
 {
     Q_OBJECT
 
@@ -27,6 +35,14 @@ public:
 
     int indexOf(const QString &packagePath) const;
 
+    /**
+     * @return @c true if the slide in @p row is used in the slideshow
+     */
+    bool isChecked(int row) const
+    {
+        return row < 0 || row >= static_cast<int>(m_checkedRows.size()) || m_checkedRows[row];
+    }
+
     /**
      * @return added directories
      */
@@ -43,13 +59,28 @@ Q_SIGNALS:
 private Q_SLOTS:
     void slotSourceModelLoadingChanged();
 
+    void slotRowsInserted(const QModelIndex &parent, int first, int last);
+    void slotRowsRemoved(const QModelIndex &parent, int first, int last);
+    void rebuildCheckedRows();
+
 private:
+    /**
+     * Updates the folders of the model to the current slide paths
+     *
+     * @param notify emit done when the model is loaded
+     */
+    void updateModel(bool notify);
+
     QSize m_targetSize;
 
-    QHash<QString, ImageProxyModel *> m_models;
-    int m_loaded = 0;
+    QStringList m_slidePaths;
+    // The folders are shared with other screens through WallpaperCatalog
+    ImageProxyModel *m_model = nullptr;
+    bool m_waitingForModel = false;
 
-    QHash<QString, bool> m_checkedTable;
+    // One bit per row, the paths are only looked up when rows are added
+    std::vector<bool> m_checkedRows;
+    QSet<QString> m_uncheckedSlides;
 
     friend class SlideModelTest;
 };
@@ -0,0 +1,289 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "slideplaylist.h"
+
+#include <QFileInfo>
+#include <QHash>
+
+#include <algorithm>
+#include <numeric>
+
+#include "model/imageroles.h"
+#include "slidefiltermodel.h"
+#include "slidemodel.h"
+
+SlidePlaylist::SlidePlaylist(SlideFilterModel *model, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_random(m_randomDevice())
+{
+    // Only needed when the playlist follows the order of the model
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, &SlidePlaylist::slotOrderChanged);
+    connect(m_model, &QAbstractItemModel::rowsRemoved, this, &SlidePlaylist::slotOrderChanged);
+    connect(m_model, &QAbstractItemModel::layoutChanged, this, &SlidePlaylist::slotOrderChanged);
+    connect(m_model, &QAbstractItemModel::modelReset, this, &SlidePlaylist::slotOrderChanged);
+}
+
+bool SlidePlaylist::shuffled() const
+{
+    return m_shuffled;
+}
+
+void SlidePlaylist::setShuffled(bool shuffled)
+{
+    m_shuffled = shuffled;
+}
+
+void SlidePlaylist::reset(const QString &first)
+{
+    if (m_sourceModel) {
+        disconnect(m_sourceModel, nullptr, this, nullptr);
+    }
+
+    m_sourceModel = m_model->sourceModel();
+    m_slideModel = qobject_cast<SlideModel *>(m_sourceModel);
+    m_rows.clear();
+    m_cursor = -1;
+    m_dirty = false;
+
+    if (!m_sourceModel) {
+        return;
+    }
+
+    if (m_shuffled) {
+        // Unchecked slides are skipped in next(), so checking a slide again needs no reset
+        m_rows.resize(m_sourceModel->rowCount());
+        std::iota(m_rows.begin(), m_rows.end(), 0);
+        std::shuffle(m_rows.begin(), m_rows.end(), m_random);
+
+        connect(m_sourceModel, &QAbstractItemModel::rowsInserted, this, &SlidePlaylist::slotRowsInserted);
+        connect(m_sourceModel, &QAbstractItemModel::rowsRemoved, this, &SlidePlaylist::slotRowsRemoved);
+        connect(m_sourceModel, &QAbstractItemModel::layoutChanged, this, [this] {
+            reset();
+        });
+        connect(m_sourceModel, &QAbstractItemModel::modelReset, this, [this] {
+            reset();
+        });
+
+        if (!m_restored.empty()) {
+            applyRestoredOrder(first);
+        }
+    } else {
+        m_rows.reserve(m_model->rowCount());
+
+        for (int row = 0; row < m_model->rowCount(); row++) {
+            m_rows.append(m_model->mapToSource(m_model->index(row, 0)).row());
+        }
+    }
+
+    if (first.isEmpty()) {
+        return;
+    }
+
+    const auto it = std::find_if(m_rows.cbegin(), m_rows.cend(), [this, &first](int row) {
+        return slideAt(row) == first;
+    });
+
+    if (it != m_rows.cend()) {
+        m_cursor = std::distance(m_rows.cbegin(), it) - 1;
+    }
+}
+
+QString SlidePlaylist::next()
+{
+    if (m_rows.empty()) {
+        // The slides are still being scanned
+        while (!m_restored.empty()) {
+            const QString path = m_restored.takeFirst();
+
+            if (path.startsWith(QLatin1String("image://")) || QFileInfo::exists(path)) {
+                return path;
+            }
+        }
+    }
+
+    if (m_dirty && !m_shuffled) {
+        // Continue after the current slide in the new order. Its row may
+        // have moved, so it is looked up by path.
+        m_dirty = false;
+        reset(m_currentSlide);
+
+        if (m_cursor >= 0) {
+            m_cursor++;
+        }
+    }
+
+    for (int i = 0; i <= m_rows.size(); i++) {
+        m_cursor++;
+
+        if (m_cursor >= m_rows.size()) {
+            m_cursor = 0;
+
+            if (m_shuffled) {
+                shuffle();
+            }
+        }
+
+        if (m_rows.empty()) {
+            break;
+        }
+
+        const int row = m_rows.at(m_cursor);
+
+        if (!isChecked(row)) {
+            continue;
+        }
+
+        m_currentSlide = slideAt(row);
+        return m_currentSlide;
+    }
+
+    return QString();
+}
+
+int SlidePlaylist::count() const
+{
+    return m_rows.size();
+}
+
+void SlidePlaylist::restore(const QStringList &upcoming)
+{
+    m_restored = upcoming;
+}
+
+QStringList SlidePlaylist::upcoming(int count) const
+{
+    if (m_rows.empty()) {
+        return m_restored.mid(0, count);
+    }
+
+    QStringList slides;
+
+    for (int i = m_cursor + 1; i < m_rows.size() && slides.size() < count; i++) {
+        if (const int row = m_rows.at(i); isChecked(row)) {
+            slides.append(slideAt(row));
+        }
+    }
+
+    return slides;
+}
+
+void SlidePlaylist::slotRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    const int count = last - first + 1;
+
+    for (int &row : m_rows) {
+        if (row >= first) {
+            row += count;
+        }
+    }
+
+    // New slides are played in the rest of this cycle
+    for (int row = first; row <= last; row++) {
+        m_rows.append(row);
+    }
+
+    std::shuffle(m_rows.begin() + m_cursor + 1, m_rows.end(), m_random);
+}
+
+void SlidePlaylist::slotRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    const int count = last - first + 1;
+    int position = 0;
+    int cursor = m_cursor;
+
+    for (int i = 0; i < m_rows.size(); i++) {
+        const int row = m_rows.at(i);
+
+        if (row >= first && row <= last) {
+            if (i <= m_cursor) {
+                cursor--;
+            }
+            continue;
+        }
+
+        m_rows[position++] = row > last ? row - count : row;
+    }
+
+    m_rows.resize(position);
+    m_cursor = cursor;
+}
+
+void SlidePlaylist::slotOrderChanged()
+{
+    m_dirty = true;
+}
+
+bool SlidePlaylist::isChecked(int row) const
+{
+    if (m_slideModel) {
+        return m_slideModel->isChecked(row);
+    }
+
+    return m_sourceModel->index(row, 0).data(ImageRoles::ToggleRole).toBool();
+}
+
+QString SlidePlaylist::slideAt(int row) const
+{
+    return m_sourceModel->index(row, 0).data(ImageRoles::PackageNameRole).toString();
+}
+
+void SlidePlaylist::shuffle()
+{
+    std::shuffle(m_rows.begin(), m_rows.end(), m_random);
+
+    // Avoid showing the same slide twice
+    if (m_rows.size() > 1 && slideAt(m_rows.constFirst()) == m_currentSlide) {
+        std::swap(m_rows.first(), m_rows[1 + std::uniform_int_distribution<int>(0, m_rows.size() - 2)(m_random)]);
+    }
+}
+
+void SlidePlaylist::applyRestoredOrder(const QString &first)
+{
+    QStringList order = m_restored;
+    m_restored.clear();
+
+    if (!first.isEmpty()) {
+        order.prepend(first);
+    }
+
+    QHash<QString, int> positions;
+    positions.reserve(order.size());
+
+    for (int i = 0; i < order.size(); i++) {
+        positions.insert(order.at(i), i);
+    }
+
+    QVector<int> restoredRows(order.size(), -1);
+    QVector<int> otherRows;
+    otherRows.reserve(m_rows.size());
+
+    for (const int row : std::as_const(m_rows)) {
+        const auto it = positions.constFind(slideAt(row));
+
+        if (it != positions.cend() && restoredRows.at(*it) < 0) {
+            restoredRows[*it] = row;
+        } else {
+            otherRows.append(row);
+        }
+    }
+
+    // The other slides are already shuffled
+    m_rows.clear();
+    std::copy_if(restoredRows.cbegin(), restoredRows.cend(), std::back_inserter(m_rows), [](int row) {
+        return row >= 0;
+    });
+    m_rows += otherRows;
+}
@@ -0,0 +1,96 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QModelIndex>
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+#include <random>
+
+class QAbstractItemModel;
+class SlideFilterModel;
+class SlideModel;
+
+/**
+ * The play order of a slideshow, kept apart from SlideFilterModel so
+ * playing does not reshuffle or sort the model shown in the config dialog.
+ *
+ * The playlist is an array of rows of the source model of SlideFilterModel
+ * and a cursor. When shuffled it keeps its own order, otherwise it follows
+ * the order of SlideFilterModel.
+ */
+class SlidePlaylist : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SlidePlaylist(SlideFilterModel *model, QObject *parent = nullptr);
+
+    bool shuffled() const;
+    void setShuffled(bool shuffled);
+
+    /**
+     * Takes the slides of the model again
+     *
+     * @param first the slide to show next if it is in the playlist
+     */
+    void reset(const QString &first = QString());
+
+    /**
+     * @return the next slide, or an empty string if there is no slide
+     */
+    QString next();
+
+    int count() const;
+
+    /**
+     * Plays @p upcoming first, e.g. the order saved in the last session.
+     * The slides are played before reset() is called, and they are kept
+     * at the start of the playlist if they are still there after reset().
+     */
+    void restore(const QStringList &upcoming);
+
+    /**
+     * @return at most @p count slides that will be played next
+     */
+    QStringList upcoming(int count) const;
+
+private Q_SLOTS:
+    void slotRowsInserted(const QModelIndex &parent, int first, int last);
+    void slotRowsRemoved(const QModelIndex &parent, int first, int last);
+    void slotOrderChanged();
+
+private:
+    bool isChecked(int row) const;
+    QString slideAt(int row) const;
+
+    /**
+     * Starts a new cycle without repeating the last slide first
+     */
+    void shuffle();
+
+    /**
+     * Moves the restored slides to the start of the playlist
+     */
+    void applyRestoredOrder(const QString &first);
+
+    QPointer<SlideFilterModel> m_model;
+    QPointer<QAbstractItemModel> m_sourceModel;
+    SlideModel *m_slideModel = nullptr;
+
+    QVector<int> m_rows;
+    QStringList m_restored;
+    int m_cursor = -1;
+    QString m_currentSlide; // Rows move when the model changes, paths do not
+    bool m_shuffled = false;
+    bool m_dirty = false; // The order of the model has changed
+
+    std::random_device m_randomDevice;
+    std::mt19937 m_random;
+};
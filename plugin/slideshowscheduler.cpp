@@ -0,0 +1,124 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "slideshowscheduler.h"
+
+#include <algorithm>
+
+#include "visibilitysource.h"
+
+SlideshowScheduler::SlideshowScheduler(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &SlideshowScheduler::slotTimeout);
+}
+
+void SlideshowScheduler::setVisibilitySource(VisibilitySource *source)
+{
+    if (source == m_source) {
+        return;
+    }
+
+    delete m_source;
+    m_source = source;
+
+    if (m_source) {
+        m_source->setParent(this);
+        connect(m_source, &VisibilitySource::visibleChanged, this, &SlideshowScheduler::updateVisibility);
+    }
+
+    updateVisibility();
+}
+
+VisibilitySource *SlideshowScheduler::visibilitySource() const
+{
+    return m_source;
+}
+
+void SlideshowScheduler::setOutputVisible(bool visible)
+{
+    if (visible == m_outputVisible) {
+        return;
+    }
+
+    m_outputVisible = visible;
+    updateVisibility();
+}
+
+bool SlideshowScheduler::isVisible() const
+{
+    return m_visible;
+}
+
+void SlideshowScheduler::start(int msec)
+{
+    // Qt::CoarseTimer already allows 5% of slack
+    const Qt::TimerType type = msec >= 60 * 1000 ? Qt::VeryCoarseTimer : Qt::CoarseTimer;
+
+    m_scheduled = true;
+    m_deadline.setRemainingTime(msec, type);
+    m_timer.setTimerType(type);
+
+    if (m_visible) {
+        m_timer.start(msec);
+    } else {
+        m_timer.stop();
+    }
+}
+
+void SlideshowScheduler::stop()
+{
+    m_scheduled = false;
+    m_timer.stop();
+}
+
+bool SlideshowScheduler::isActive() const
+{
+    return m_scheduled;
+}
+
+Qt::TimerType SlideshowScheduler::timerType() const
+{
+    return m_timer.timerType();
+}
+
+void SlideshowScheduler::slotTimeout()
+{
+    m_scheduled = false;
+    Q_EMIT timeout();
+}
+
+void SlideshowScheduler::updateVisibility()
+{
+    const bool visible = m_outputVisible && (!m_source || m_source->isVisible());
+
+    if (visible == m_visible) {
+        return;
+    }
+
+    m_visible = visible;
+
+    if (!m_visible) {
+        // Nothing wakes up until the wallpaper can be seen again
+        m_timer.stop();
+        Q_EMIT visibleChanged(false);
+        return;
+    }
+
+    Q_EMIT visibleChanged(true);
+
+    if (!m_scheduled) {
+        return;
+    }
+
+    if (m_deadline.hasExpired()) {
+        // Catch up with one slide, not with every missed one
+        slotTimeout();
+    } else {
+        m_timer.start(static_cast<int>(std::max<qint64>(0, m_deadline.remainingTime())));
+    }
+}
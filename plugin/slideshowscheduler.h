@@ -0,0 +1,79 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QDeadlineTimer>
+#include <QObject>
+#include <QTimer>
+
+class VisibilitySource;
+
+/**
+ * The slide timer, which does not wake up while the wallpaper cannot be seen.
+ *
+ * While the wallpaper is hidden the timer is stopped. When it can be seen
+ * again, a slide that came due in the meantime is shown once, instead of
+ * every slide that was missed. Long intervals use a very coarse timer so the
+ * wakeup can be merged with others.
+ */
+class SlideshowScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SlideshowScheduler(QObject *parent = nullptr);
+
+    /**
+     * Replaces the visibility source, e.g. with a stub in tests.
+     * The scheduler takes ownership of @p source, which can be @c nullptr.
+     */
+    void setVisibilitySource(VisibilitySource *source);
+    VisibilitySource *visibilitySource() const;
+
+    /**
+     * Whether the window of the wallpaper is shown, set by QML
+     */
+    void setOutputVisible(bool visible);
+
+    /**
+     * @return @c true if the output is shown and the session is not idle
+     */
+    bool isVisible() const;
+
+    /**
+     * Emits timeout() once after @p msec, replacing the previous schedule
+     */
+    void start(int msec);
+    void stop();
+
+    /**
+     * @return @c true if timeout() is scheduled, even if it is deferred
+     */
+    bool isActive() const;
+    Qt::TimerType timerType() const;
+
+Q_SIGNALS:
+    void timeout();
+
+    /**
+     * Emitted before a deferred timeout(), e.g. to show the frame for now
+     */
+    void visibleChanged(bool visible);
+
+private Q_SLOTS:
+    void slotTimeout();
+    void updateVisibility();
+
+private:
+    VisibilitySource *m_source = nullptr;
+
+    QTimer m_timer;
+    QDeadlineTimer m_deadline;
+    bool m_scheduled = false;
+    bool m_outputVisible = true;
+    bool m_visible = true;
+};
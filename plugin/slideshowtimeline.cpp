@@ -0,0 +1,206 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "slideshowtimeline.h"
+
+#include <QFileInfo>
+#include <QHash>
+
+#include <algorithm>
+#include <mutex>
+
+#include "finder/xmlfinder.h"
+
+struct CachedTimeline {
+    qint64 modified = 0;
+    std::shared_ptr<const SlideshowTimeline> timeline;
+};
+
+// One entry per slideshow and target size
+constexpr int s_maxTimelines = 64;
+
+static QHash<QString, CachedTimeline> s_timelines;
+static std::mutex s_timelinesMutex;
+
+SlideshowTimeline::SlideshowTimeline(const SlideshowData &data)
+    : m_startTime(data.starttime)
+{
+    const int count = data.data.size();
+
+    m_starts.reserve(count + 1);
+    m_from.reserve(count);
+    m_to.reserve(count);
+
+    qint64 totalTime = 0;
+    // Long slideshows repeat a few images many times
+    QHash<QString, int> fileIndices;
+
+    const auto fileIndex = [this, &fileIndices](const QString &file) {
+        auto it = fileIndices.find(file);
+
+        if (it == fileIndices.end()) {
+            it = fileIndices.insert(file, m_files.size());
+            m_files.append(file);
+        }
+
+        return it.value();
+    };
+
+    for (const SlideshowItemData &item : data.data) {
+        m_starts.push_back(totalTime);
+        totalTime += item.duration;
+
+        if (item.dataType == 0) {
+            m_from.push_back(fileIndex(item.file));
+            m_to.push_back(-1);
+        } else {
+            m_from.push_back(fileIndex(item.from));
+            m_to.push_back(fileIndex(item.to));
+        }
+    }
+
+    m_starts.push_back(totalTime);
+}
+
+std::shared_ptr<const SlideshowTimeline> SlideshowTimeline::load(const QString &path, const QSize &targetSize)
+{
+    const QFileInfo info(path);
+
+    if (!info.exists()) {
+        return nullptr;
+    }
+
+    // The size picks one of the images listed for a static item
+    const QString key = QStringLiteral("%1@%2x%3").arg(info.absoluteFilePath(), QString::number(targetSize.width()), QString::number(targetSize.height()));
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+    {
+        std::lock_guard lock(s_timelinesMutex);
+
+        if (const auto it = s_timelines.constFind(key); it != s_timelines.cend() && it->modified == modified) {
+            return it->timeline;
+        }
+    }
+
+    auto timeline = std::make_shared<const SlideshowTimeline>(XmlFinder::parseSlideshowXml(path, targetSize));
+
+    if (!timeline->isValid()) {
+        return nullptr;
+    }
+
+    std::lock_guard lock(s_timelinesMutex);
+
+    if (s_timelines.size() >= s_maxTimelines && !s_timelines.contains(key)) {
+        // Drop what nobody holds anymore first, e.g. the sizes of a removed screen
+        for (auto it = s_timelines.begin(); it != s_timelines.end();) {
+            it = it->timeline.use_count() == 1 ? s_timelines.erase(it) : std::next(it);
+        }
+
+        if (s_timelines.size() >= s_maxTimelines) {
+            s_timelines.clear();
+        }
+    }
+
+    s_timelines.insert(key, {modified, timeline});
+
+    return timeline;
+}
+
+bool SlideshowTimeline::isValid() const
+{
+    return !m_from.empty() && totalTime() > 0;
+}
+
+int SlideshowTimeline::count() const
+{
+    return m_from.size();
+}
+
+QDateTime SlideshowTimeline::startTime(const QDateTime &time) const
+{
+    if (m_startTime.isValid() && m_startTime <= time) {
+        return m_startTime;
+    }
+
+    // Use 0:00 of the day before, or the time of day in the file
+    QDateTime startTime = time.toLocalTime().date().addDays(-1).startOfDay();
+
+    if (m_startTime.time().isValid()) {
+        startTime.setTime(m_startTime.time());
+    }
+
+    return startTime;
+}
+
+qint64 SlideshowTimeline::totalTime() const
+{
+    return m_starts.empty() ? 0 : m_starts.back();
+}
+
+SlideshowTimeline::Frame SlideshowTimeline::frameAt(const QDateTime &time) const
+{
+    return frameAtPosition(cyclePosition(time));
+}
+
+SlideshowTimeline::Frame SlideshowTimeline::frameAtPosition(qint64 position) const
+{
+    Frame frame;
+
+    if (!isValid()) {
+        return frame;
+    }
+
+    position = ((position % totalTime()) + totalTime()) % totalTime();
+
+    // The last item that starts at or before the position. Items without a duration are skipped.
+    const auto it = std::upper_bound(m_starts.cbegin(), m_starts.cend(), position);
+    const int index = std::clamp<int>(std::distance(m_starts.cbegin(), it) - 1, 0, count() - 1);
+
+    frame.position = position;
+    frame.start = m_starts.at(index);
+    frame.end = m_starts.at(index + 1);
+    frame.file = m_files.at(m_from.at(index));
+
+    if (const int to = m_to.at(index); to >= 0) {
+        frame.isTransition = true;
+        frame.to = m_files.at(to);
+        frame.progress = (position - frame.start) / static_cast<double>(frame.end - frame.start);
+    }
+
+    return frame;
+}
+
+QDateTime SlideshowTimeline::nextBoundary(const QDateTime &time) const
+{
+    if (!isValid()) {
+        return QDateTime();
+    }
+
+    const Frame frame = frameAt(time);
+
+    return time.addSecs(frame.end - frame.position);
+}
+
+QStringList SlideshowTimeline::staticFiles() const
+{
+    QStringList files;
+
+    for (std::size_t i = 0; i < m_from.size(); i++) {
+        if (m_to.at(i) < 0) {
+            files.append(m_files.at(m_from.at(i)));
+        }
+    }
+
+    return files;
+}
+
+qint64 SlideshowTimeline::cyclePosition(const QDateTime &time) const
+{
+    const QDateTime startTime = this->startTime(time);
+
+    // Counted in wall clock time, so a daily slideshow keeps its time of day across DST changes
+    return startTime.secsTo(time) + time.offsetFromUtc() - startTime.offsetFromUtc();
+}
@@ -0,0 +1,85 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QDateTime>
+#include <QSize>
+#include <QStringList>
+
+#include <memory>
+#include <vector>
+
+struct SlideshowData;
+
+/**
+ * An XML slideshow compiled for lookups by time.
+ *
+ * The start of every item in the cycle is kept as a prefix sum of the
+ * durations, so the frame at a time and the next boundary after it are
+ * found by binary search. Files are stored once and referred to by index.
+ *
+ * A timeline is immutable. The timer, the image provider and the preview
+ * generator share the same compiled timeline through load().
+ */
+class SlideshowTimeline
+{
+public:
+    struct Frame {
+        bool isTransition = false;
+        QString file; // The static image, or the image a transition starts from
+        QString to; // The image a transition ends with
+        double progress = 0; // From 0 to 1 during a transition
+        qint64 position = 0; // Seconds since the start of the cycle
+        qint64 start = 0; // Start of the item in the cycle
+        qint64 end = 0;
+    };
+
+    SlideshowTimeline() = default;
+    explicit SlideshowTimeline(const SlideshowData &data);
+
+    /**
+     * @return the compiled slideshow in @p path, parsed again only when the
+     * file changes, or @c nullptr if it cannot be parsed
+     */
+    static std::shared_ptr<const SlideshowTimeline> load(const QString &path, const QSize &targetSize);
+
+    bool isValid() const;
+    int count() const;
+
+    /**
+     * @return the start of the cycle used at @p time, the day before at the
+     * time of day in the file if the file sets no start or one after @p time
+     */
+    QDateTime startTime(const QDateTime &time) const;
+
+    /**
+     * @return the length of a cycle in seconds
+     */
+    qint64 totalTime() const;
+
+    Frame frameAt(const QDateTime &time) const;
+    Frame frameAtPosition(qint64 position) const;
+
+    /**
+     * @return when the item shown at @p time ends
+     */
+    QDateTime nextBoundary(const QDateTime &time) const;
+
+    /**
+     * @return the image of every static item, in order
+     */
+    QStringList staticFiles() const;
+
+private:
+    qint64 cyclePosition(const QDateTime &time) const;
+
+    QStringList m_files;
+    std::vector<qint64> m_starts; // One more than the items, the last one is the total time
+    std::vector<int> m_from; // The static image or the image a transition starts from
+    std::vector<int> m_to; // -1 for a static item
+    QDateTime m_startTime; // As set in the file, may be null or in the future
+};
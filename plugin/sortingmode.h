@@ -18,6 +18,7 @@ public:
         AlphabeticalReversed,
         Modified,
         ModifiedReversed,
+        Sampling, /**< Random images picked without listing all slides first */
     };
     Q_ENUM(Mode)
 };
@@ -0,0 +1,63 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "visibilitysource.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+
+static const QString s_screenSaverService = QStringLiteral("org.freedesktop.ScreenSaver");
+static const QString s_screenSaverPath = QStringLiteral("/ScreenSaver");
+
+VisibilitySource::VisibilitySource(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SessionVisibilitySource::SessionVisibilitySource(QObject *parent)
+    : VisibilitySource(parent)
+{
+    // clang-format off
+    QDBusConnection::sessionBus().connect(s_screenSaverService,
+        s_screenSaverPath,
+        s_screenSaverService,
+        QStringLiteral("ActiveChanged"),
+        this,
+        SLOT(slotActiveChanged(bool))
+    );
+    // clang-format on
+
+    // The session may already be locked, don't block the startup to find out
+    const QDBusMessage message = QDBusMessage::createMethodCall(s_screenSaverService, s_screenSaverPath, s_screenSaverService, QStringLiteral("GetActive"));
+    auto watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(message), this);
+
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *watcher) {
+        const QDBusPendingReply<bool> reply = *watcher;
+
+        if (!reply.isError()) {
+            slotActiveChanged(reply.value());
+        }
+
+        watcher->deleteLater();
+    });
+}
+
+bool SessionVisibilitySource::isVisible() const
+{
+    return !m_screenSaverActive;
+}
+
+void SessionVisibilitySource::slotActiveChanged(bool active)
+{
+    if (active == m_screenSaverActive) {
+        return;
+    }
+
+    m_screenSaverActive = active;
+    Q_EMIT visibleChanged(!active);
+}
@@ -0,0 +1,46 @@
+/*
+    SPDX-FileCopyrightText: 2022 Fushan Wen <qydwhotmail@gmail.com>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+
+/**
+ * Tells whether the wallpaper can be seen at all, e.g. it cannot while the
+ * session is locked or the screen saver is active.
+ */
+class VisibilitySource : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VisibilitySource(QObject *parent = nullptr);
+
+    virtual bool isVisible() const = 0;
+
+Q_SIGNALS:
+    void visibleChanged(bool visible);
+};
+
+/**
+ * Follows org.freedesktop.ScreenSaver of the session, which is active while
+ * the screen is locked or blanked by the screen saver
+ */
+class SessionVisibilitySource : public VisibilitySource
+{
+    Q_OBJECT
+
+public:
+    explicit SessionVisibilitySource(QObject *parent = nullptr);
+
+    bool isVisible() const override;
+
+private Q_SLOTS:
+    void slotActiveChanged(bool active);
+
+private:
+    bool m_screenSaverActive = false;
+};
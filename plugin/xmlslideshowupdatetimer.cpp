@@ -6,21 +6,36 @@
 
 #include "xmlslideshowupdatetimer.h"
 
+#include <QDateTime>
+
+#include <algorithm>
+#include <limits>
+
 #include "clockskewnotifier/clockskewnotifierengine_p.h"
-#include "finder/xmlfinder.h"
+#include "slideshowtimeline.h"
 
 XmlSlideshowUpdateTimer::XmlSlideshowUpdateTimer(QObject *parent)
     : QTimer(parent)
 {
     setInterval(60000);
+    // At least 1min, so the wakeup can be aligned to a full second
+    setTimerType(Qt::VeryCoarseTimer);
+
+    m_prerenderTimer.setSingleShot(true);
+    connect(&m_prerenderTimer, &QTimer::timeout, this, [this] {
+        Q_EMIT prerenderRequested(m_xmlpath, m_nextUpdate);
+    });
 }
 
 void XmlSlideshowUpdateTimer::setActive(bool active)
 {
-    if (active == isActive()) {
+    // Not isActive(), the timer is stopped while paused
+    if (active == m_enabled) {
         return;
     }
 
+    m_enabled = active;
+
     if (active) {
         alignInterval();
 
@@ -31,6 +46,7 @@ void XmlSlideshowUpdateTimer::setActive(bool active)
         }
     } else {
         stop();
+        m_prerenderTimer.stop();
         isTransition = false;
 
         if (m_engine) {
@@ -40,86 +56,80 @@ void XmlSlideshowUpdateTimer::setActive(bool active)
     }
 }
 
-void XmlSlideshowUpdateTimer::adjustInterval(const QString &xmlpath)
+bool XmlSlideshowUpdateTimer::isEnabled() const
 {
-    if (xmlpath.isEmpty()) {
-        return;
-    }
+    return m_enabled;
+}
 
-    // The size is not needed here, so just set a default value.
-    const SlideshowData sData = XmlFinder::parseSlideshowXml(xmlpath, QSize(1920, 1080));
+void XmlSlideshowUpdateTimer::setPaused(bool paused)
+{
+    m_paused = paused;
 
-    std::tie(m_intervals, m_totalTime) = slideshowTimeList(sData);
-    m_startTime = slideshowStartTime(sData);
+    if (m_paused) {
+        stop();
+        m_prerenderTimer.stop();
+    }
 }
 
-void XmlSlideshowUpdateTimer::alignInterval()
+void XmlSlideshowUpdateTimer::adjustInterval(const QString &xmlpath)
 {
-    if (m_intervals.empty() || m_totalTime <= 0 || !m_startTime.isValid()) {
+    if (xmlpath.isEmpty()) {
         return;
     }
 
-    const qint64 timeDiff = m_startTime.secsTo(QDateTime::currentDateTime());
+    // The size is not needed here, so just set a default value.
+    m_timeline = SlideshowTimeline::load(xmlpath, QSize(1920, 1080));
+    m_xmlpath = xmlpath;
+}
 
-    // Align to remaining time
-    const qint64 modTime = timeDiff % m_totalTime;
-    int interval = 0;
-
-    for (int i = 0; i < static_cast<int>(m_intervals.size()); i++) {
-        const auto &p = m_intervals.at(i);
-
-        if (p.second > modTime) {
-            if (m_intervals.at(i - 1).first == 0) {
-                // static, calculate remaining time
-                interval = (p.second - modTime) * 1000; // sec to msec
-                isTransition = false;
-            } else {
-                // transition
-                interval = std::min<int>(p.second - modTime, 600) * 1000;
-                isTransition = true;
-            }
-
-            break;
-        }
-    }
+void XmlSlideshowUpdateTimer::setPrerenderLeadTime(int msec)
+{
+    m_prerenderLeadTime = std::max(0, msec);
 
-    // overflow
-    if (interval < 0) {
-        interval = std::numeric_limits<int>::max();
+    if (m_prerenderLeadTime == 0) {
+        m_prerenderTimer.stop();
     }
-
-    // At least 1min
-    setInterval(std::max(60 * 1000, interval));
-    start();
 }
 
-QDateTime XmlSlideshowUpdateTimer::slideshowStartTime(const SlideshowData &sData)
+int XmlSlideshowUpdateTimer::prerenderLeadTime() const
 {
-    QDateTime startTime = sData.starttime;
-
-    if (startTime.isNull() || startTime > QDateTime::currentDateTime()) {
-        // Use 0:00 as the start time
-        startTime = QDate::currentDate().startOfDay().addDays(-1);
+    return m_prerenderLeadTime;
+}
 
-        if (sData.starttime.time().isValid()) {
-            startTime.setTime(sData.starttime.time());
-        }
+void XmlSlideshowUpdateTimer::alignInterval()
+{
+    if (!m_timeline) {
+        return;
     }
 
-    return startTime;
-}
+    // Align to remaining time
+    const QDateTime now = QDateTime::currentDateTime();
+    const SlideshowTimeline::Frame frame = m_timeline->frameAt(now);
+    const qint64 remaining = frame.end - frame.position;
+    qint64 interval = 0;
+
+    if (!frame.isTransition) {
+        // static, calculate remaining time
+        interval = remaining * 1000; // sec to msec
+        isTransition = false;
+    } else {
+        // transition
+        interval = std::min<qint64>(remaining, 600) * 1000;
+        isTransition = true;
+    }
 
-TimeListPair XmlSlideshowUpdateTimer::slideshowTimeList(const SlideshowData &sData)
-{
-    decltype(m_intervals) timeList;
-    qint64 totalTime = 0;
+    // At least 1min, and no overflow
+    setInterval(std::clamp<qint64>(interval, 60 * 1000, std::numeric_limits<int>::max()));
 
-    for (const auto &item : std::as_const(sData.data)) {
-        timeList.emplace_back(std::make_pair(item.dataType, totalTime));
-        totalTime += item.duration;
+    if (m_paused) {
+        return;
     }
 
-    timeList.emplace_back(std::make_pair(0, totalTime));
+    start();
 
-    return {timeList, totalTime};
+    // Decode the next frame before it is requested, so it is shown on time
+    if (m_prerenderLeadTime > 0) {
+        m_nextUpdate = now.addMSecs(QTimer::interval());
+        m_prerenderTimer.start(std::max(0, QTimer::interval() - m_prerenderLeadTime));
+    }
 }
@@ -10,11 +10,10 @@
 #include <QDateTime>
 #include <QTimer>
 
-class ClockSkewNotifierEngine;
-class SlideshowData;
+#include <memory>
 
-using TimeList = std::vector<std::pair<int /* type */, qint64>>;
-using TimeListPair = std::pair<TimeList, qint64 /* total time */>;
+class ClockSkewNotifierEngine;
+class SlideshowTimeline;
 
 /**
  * A timer that controls the XML slideshow progress
@@ -32,11 +31,22 @@ public:
      * @param active @c true if the timer should be activated, @c false otherwise.
      */
     void setActive(bool active);
+    bool isEnabled() const;
+
+    /**
+     * Stops the timer while the wallpaper cannot be seen. The timer starts
+     * again with the next alignInterval() call after it is resumed.
+     */
+    void setPaused(bool paused);
 
     void adjustInterval(const QString &xmlpath);
 
-    static QDateTime slideshowStartTime(const SlideshowData &sData);
-    static TimeListPair slideshowTimeList(const SlideshowData &sData);
+    /**
+     * How long before the next update prerenderRequested() is emitted,
+     * 0 to disable pre-rendering.
+     */
+    void setPrerenderLeadTime(int msec);
+    int prerenderLeadTime() const;
 
     bool isTransition = false;
 
@@ -46,12 +56,23 @@ public Q_SLOTS:
 Q_SIGNALS:
     void clockSkewed();
 
+    /**
+     * Emitted ahead of the next update with the frame @p time it will show
+     */
+    void prerenderRequested(const QString &xmlpath, const QDateTime &time);
+
 private:
     ClockSkewNotifierEngine *m_engine = nullptr;
 
-    std::vector<std::pair<int /* type */, qint64>> m_intervals;
-    qint64 m_totalTime = -1;
-    QDateTime m_startTime;
+    std::shared_ptr<const SlideshowTimeline> m_timeline;
+    QString m_xmlpath;
+
+    QTimer m_prerenderTimer;
+    QDateTime m_nextUpdate;
+    int m_prerenderLeadTime = 10000;
+
+    bool m_enabled = false;
+    bool m_paused = false;
 };
 
 #endif // SLIDESHOWUPDATETIMER_H
@@ -60,6 +60,10 @@ ColumnLayout {
                     {
                         'label': i18nd("plasma_wallpaper_org.kde.image", "Date modified (oldest first)"),
                         'slideshowMode':  PlasmaWallpaper.SortingMode.Modified
+                    },
+                    {
+                        'label': i18nd("plasma_wallpaper_org.kde.image", "Random (for very large folders)"),
+                        'slideshowMode':  PlasmaWallpaper.SortingMode.Sampling
                     }
                 ]
                 textRole: "label"